@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Measure how IR generation scales with the number of threads given by -j.
+
+A program of many functions is generated by bench/gen_program.py, each with
+loops, branches and usually a call to the function before it, and compiled
+with -j 1, 2, 4, ... up to --max-threads. Every run must print the same
+module, byte for byte, as the run with one thread; the speedup is relative
+to that run. The time of generating IR in place, without -j, is printed for
+reference.
+
+Usage: bench/codegen_scaling.py [--cxc bin/main] [--functions N]
+                                [--max-threads N] [--repeat N] [-O LEVEL]
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+from gen_program import generate
+
+
+def compile_once(cxc, path, opt, threads):
+    args = [cxc, "-O%d" % opt, "--emit=llvm", "-o", "-", path]
+    if threads:
+        args[1:1] = ["-j", str(threads)]
+    start = time.perf_counter()
+    proc = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    elapsed = time.perf_counter() - start
+    if proc.returncode != 0:
+        sys.exit("Error: '%s' failed:\n%s" %
+                 (" ".join(args), proc.stderr.decode()[-2000:]))
+    return elapsed, proc.stdout
+
+
+def measure(cxc, path, opt, threads, repeat):
+    best, output = None, None
+    for _ in range(repeat):
+        elapsed, output = compile_once(cxc, path, opt, threads)
+        best = elapsed if best is None else min(best, elapsed)
+    return best, output
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cxc", default="bin/main",
+                        help="compiler to measure (default: bin/main)")
+    parser.add_argument("--functions", type=int, default=4000,
+                        help="functions in the program (default: 4000)")
+    parser.add_argument("--max-threads", type=int,
+                        default=max(os.cpu_count() or 1, 4),
+                        help="largest -j to try (default: CPU count, >= 4)")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="runs per thread count, the fastest is kept")
+    parser.add_argument("-O", dest="opt", type=int, default=0,
+                        choices=range(4), help="optimization level")
+    args = parser.parse_args()
+
+    if not os.access(args.cxc, os.X_OK):
+        sys.exit("Error: cannot execute '%s'; run make first" % args.cxc)
+
+    with tempfile.NamedTemporaryFile("w", suffix=".c", delete=False) as f:
+        f.write(generate(functions=args.functions))
+        path = f.name
+    try:
+        print("%d functions, -O%d, %d CPUs" %
+              (args.functions, args.opt, os.cpu_count() or 1))
+        print("  %8s %10s %8s %10s" % ("threads", "time (s)", "speedup",
+                                        "output"))
+        t, _ = measure(args.cxc, path, args.opt, 0, args.repeat)
+        print("  %8s %10.3f %8s %10s" % ("in place", t, "", ""))
+
+        threads, base, reference = 1, None, None
+        failed = False
+        while threads <= args.max_threads:
+            t, output = measure(args.cxc, path, args.opt, threads,
+                                args.repeat)
+            if reference is None:
+                base, reference = t, output
+            same = output == reference
+            failed |= not same
+            print("  %8d %10.3f %7.2fx %10s" %
+                  (threads, t, base / t, "same" if same else "DIFFERS"))
+            threads *= 2
+    finally:
+        os.unlink(path)
+
+    if failed:
+        sys.exit("Error: the output depends on the number of threads")
+
+
+if __name__ == "__main__":
+    main()
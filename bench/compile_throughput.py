@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""Measure compile throughput by phase on generated programs of several shapes.
+
+Each shape stresses one part of the front end with a program from
+bench/gen_program.py:
+
+  functions    many small functions
+  nesting      deeply nested blocks
+  switch       one huge switch
+  expressions  long arithmetic expressions
+  globals      many global variables
+  mixed        some of each
+
+Every program is compiled --repeat times with -ftime-report=json and
+--mem-report=json. For each phase, the median time is printed along with the
+lines and tokens it gets through per second; the peak resident set is printed
+after each of start-up, the front end, optimization and emission. Phases are
+summed over threads, so the benchmark is run without -j.
+
+Usage: bench/compile_throughput.py [--cxc bin/main] [--shapes a,b,...]
+                                   [--scale X] [--repeat N] [-O LEVEL]
+                                   [--emit KIND] [--json FILE]
+"""
+
+import argparse
+import json
+import os
+import re
+import statistics
+import subprocess
+import sys
+import tempfile
+
+from gen_program import generate
+
+SHAPES = {
+    "functions": dict(functions=2000),
+    "nesting": dict(depth=400),
+    "switch": dict(cases=4000),
+    "expressions": dict(terms=40000),
+    "globals": dict(globals=6000),
+    "mixed": dict(functions=400, depth=40, cases=400, terms=4000,
+                  globals=400),
+}
+
+PHASES = ["lex", "parse", "sema", "irgen", "verify", "opt", "emit"]
+
+TOKEN = re.compile(r"/\*.*?\*/|([A-Za-z_]\w*|\d+(?:\.\d*)?(?:[eE][+-]?\d+)?"
+                   r"|<=|>=|==|!=|\|\||&&|\+\+|--|\S)", re.S)
+
+
+def count_tokens(source):
+    return sum(1 for m in TOKEN.finditer(source) if m.group(1))
+
+
+def parse_reports(stderr):
+    """Split stderr into the time report and the memory report."""
+    decoder = json.JSONDecoder()
+    reports, pos = [], 0
+    while len(reports) < 2:
+        pos = stderr.find("{", pos)
+        if pos < 0:
+            break
+        report, pos = decoder.raw_decode(stderr, pos)
+        reports.append(report)
+    if len(reports) != 2:
+        raise ValueError("no reports in the output of the compiler")
+    return reports
+
+
+def compile_once(cxc, path, opt, emit):
+    args = [cxc, "-O%d" % opt, "--emit=%s" % emit, "-o", os.devnull,
+            "-ftime-report=json", "--mem-report=json", path]
+    proc = subprocess.run(args, stdout=subprocess.DEVNULL,
+                          stderr=subprocess.PIPE, universal_newlines=True)
+    if proc.returncode != 0:
+        sys.exit("Error: '%s' failed:\n%s" %
+                 (" ".join(args), proc.stderr[-2000:]))
+    times, memory = parse_reports(proc.stderr)
+    return {
+        "wall_ms": times["wall_ms"],
+        "phases_ms": {p: times["phases_ms"][p] for p in PHASES},
+        "peak_rss_kib": {m["phase"]: m["kib"]
+                         for m in memory["peak_rss_kib"]},
+    }
+
+
+def measure(cxc, shape, scale, opt, emit, repeat):
+    sizes = {k: max(1, int(v * scale)) for k, v in shape.items()}
+    source = generate(**sizes)
+    with tempfile.NamedTemporaryFile("w", suffix=".c", delete=False) as f:
+        f.write(source)
+        path = f.name
+    try:
+        samples = [compile_once(cxc, path, opt, emit) for _ in range(repeat)]
+    finally:
+        os.unlink(path)
+    return {
+        "sizes": sizes,
+        "lines": source.count("\n"),
+        "tokens": count_tokens(source),
+        "bytes": len(source),
+        "samples": samples,
+    }
+
+
+def median(values):
+    return statistics.median(values) if values else 0.0
+
+
+def rate(count, ms):
+    return count / (ms / 1e3) if ms > 0 else float("inf")
+
+
+def print_shape(name, result):
+    lines, tokens = result["lines"], result["tokens"]
+    samples = result["samples"]
+    print("%s: %s; %d lines, %d tokens, %.1f KiB" %
+          (name, ", ".join("%s=%d" % kv for kv in sorted(
+              result["sizes"].items())),
+           lines, tokens, result["bytes"] / 1024))
+    print("  %-8s %10s %12s %12s" % ("phase", "ms", "lines/s", "tokens/s"))
+    for phase in PHASES + ["wall"]:
+        if phase == "wall":
+            ms = median([s["wall_ms"] for s in samples])
+        else:
+            ms = median([s["phases_ms"][phase] for s in samples])
+        print("  %-8s %10.2f %12.0f %12.0f" %
+              (phase, ms, rate(lines, ms), rate(tokens, ms)))
+    last, peaks = 0, []
+    for phase in samples[0]["peak_rss_kib"]:
+        kib = median([s["peak_rss_kib"][phase] for s in samples])
+        peaks.append("%s %.1f (+%.1f)" %
+                     (phase, kib / 1024, (kib - last) / 1024))
+        last = kib
+    print("  peak RSS after, MiB: " + ", ".join(peaks))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cxc", default="bin/main",
+                        help="compiler to measure (default: bin/main)")
+    parser.add_argument("--shapes", default=",".join(SHAPES),
+                        help="comma-separated shapes (default: all)")
+    parser.add_argument("--scale", type=float, default=1.0,
+                        help="factor on the size of every program")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="runs per shape, the median is printed")
+    parser.add_argument("-O", dest="opt", type=int, default=0,
+                        choices=range(4), help="optimization level")
+    parser.add_argument("--emit", default="obj",
+                        choices=["llvm", "bc", "asm", "obj"],
+                        help="output kind (default: obj)")
+    parser.add_argument("--json", metavar="FILE",
+                        help="also write every sample to FILE as JSON")
+    args = parser.parse_args()
+
+    if not os.access(args.cxc, os.X_OK):
+        sys.exit("Error: cannot execute '%s'; run make first" % args.cxc)
+    names = [s for s in args.shapes.split(",") if s]
+    for name in names:
+        if name not in SHAPES:
+            sys.exit("Error: unknown shape '%s'; choose from %s" %
+                     (name, ", ".join(SHAPES)))
+
+    print("Compile throughput of %s, -O%d, --emit=%s, median of %d runs\n" %
+          (args.cxc, args.opt, args.emit, args.repeat))
+    results = {}
+    for name in names:
+        results[name] = measure(args.cxc, SHAPES[name], args.scale,
+                                args.opt, args.emit, max(args.repeat, 1))
+        print_shape(name, results[name])
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"opt": args.opt, "emit": args.emit,
+                       "scale": args.scale, "shapes": results}, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
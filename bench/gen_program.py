@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Generate a valid CX program of a given shape, for compile-time benchmarks.
+
+Each option grows one feature of the program and leaves the rest alone:
+
+  --functions N   N functions with loops and branches, each calling the one
+                  before it
+  --depth N       N nested blocks in main, alternating if, while and for, each
+                  declaring a variable
+  --cases N       a switch of N cases in main
+  --terms N       N terms of arithmetic in main, in expressions of at most
+                  --expr-terms terms each
+  --globals N     N global variables of every type, the int ones read by
+                  main
+
+The same options and seed always give the same program. It is written to
+stdout, or to the file given by -o.
+
+Usage: bench/gen_program.py [--functions N] [--depth N] [--cases N]
+                            [--terms N] [--expr-terms N] [--globals N]
+                            [--seed N] [-o FILE]
+"""
+
+import argparse
+import random
+import sys
+
+
+def gen_globals(out, rng, count):
+    for i in range(count):
+        kind = i % 3
+        if kind == 0:
+            out.append("int g%d = %d;" % (i, rng.randrange(1000)))
+        elif kind == 1:
+            out.append("double g%d = %d.%d;" %
+                       (i, rng.randrange(100), rng.randrange(10)))
+        else:
+            out.append("bool g%d = %s;" % (i, rng.choice(["true", "false"])))
+
+
+def gen_functions(out, rng, count):
+    for i in range(count):
+        out.append("int f%d(int n) {" % i)
+        out.append("  int s = %d;" % rng.randrange(100))
+        out.append("  for (int k = 0; k < n; ++k) {")
+        out.append("    if (k %% %d == 0) {" % rng.randrange(2, 9))
+        out.append("      s = s + k * %d;" % rng.randrange(1, 10))
+        out.append("    } else {")
+        out.append("      s = s - %d;" % rng.randrange(1, 10))
+        out.append("    }")
+        out.append("  }")
+        out.append("  while (s > 1000) {")
+        out.append("    s = s / 2;")
+        out.append("  }")
+        # Short call chains, so that -O2 does not inline everything into one.
+        if i % 16 != 0:
+            out.append("  s = s + f%d(n - 1);" % (i - 1))
+        out.append("  return s;")
+        out.append("}")
+
+
+def gen_nesting(out, rng, depth):
+    for d in range(depth):
+        indent = "  " * (d + 1)
+        kind = d % 3
+        if kind == 0:
+            out.append(indent + "if (x > %d) {" % rng.randrange(100))
+        elif kind == 1:
+            out.append(indent + "while (x < %d) {" % rng.randrange(100))
+        else:
+            out.append(indent + "for (int i%d = 0; i%d < 2; ++i%d) {" %
+                       (d, d, d))
+        out.append(indent + "  int v%d = x + %d;" % (d, d))
+        out.append(indent + "  x = v%d;" % d)
+    for d in reversed(range(depth)):
+        out.append("  " * (d + 1) + "}")
+
+
+def gen_switch(out, rng, cases):
+    out.append("  switch (x) {")
+    for i in range(cases):
+        out.append("  case %d:" % i)
+        out.append("    x = x * %d + %d;" %
+                   (rng.randrange(1, 10), rng.randrange(100)))
+        out.append("    break;")
+    out.append("  default:")
+    out.append("    x = 0;")
+    out.append("  }")
+
+
+def gen_terms(out, rng, terms, per_expr):
+    operators = ["+", "-", "*", "+", "-"]
+    operands = ["x", "y", "z"]
+    while terms > 0:
+        n = min(terms, per_expr)
+        terms -= n
+        parts = [rng.choice(operands)]
+        for _ in range(n - 1):
+            operand = (rng.choice(operands) if rng.randrange(2)
+                       else str(rng.randrange(1, 100)))
+            parts.append(rng.choice(operators))
+            parts.append(operand)
+        # Wrapped at a fixed width, so that lines per second stay meaningful.
+        line = "  y ="
+        for part in parts:
+            if len(line) + len(part) > 78:
+                out.append(line)
+                line = "   "
+            line += " " + part
+        out.append(line + ";")
+
+
+def generate(functions=0, depth=0, cases=0, terms=0, expr_terms=500,
+             globals=0, seed=1):
+    rng = random.Random(seed)
+    out = []
+    gen_globals(out, rng, globals)
+    gen_functions(out, rng, functions)
+    out.append("int main() {")
+    out.append("  int x;")
+    out.append("  int y = 1;")
+    out.append("  int z = 2;")
+    out.append("  read x;")
+    gen_nesting(out, rng, depth)
+    if cases:
+        gen_switch(out, rng, cases)
+    gen_terms(out, rng, terms, max(expr_terms, 1))
+    for i in range(0, globals, 3):
+        out.append("  x = x + g%d;" % i)
+    if functions:
+        out.append("  x = x + f%d(x);" % (functions - 1))
+    out.append("  write x + y + z;")
+    out.append("  return 0;")
+    out.append("}")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--functions", type=int, default=0)
+    parser.add_argument("--depth", type=int, default=0)
+    parser.add_argument("--cases", type=int, default=0)
+    parser.add_argument("--terms", type=int, default=0)
+    parser.add_argument("--expr-terms", type=int, default=500)
+    parser.add_argument("--globals", type=int, default=0)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("-o", dest="output", default="-")
+    args = parser.parse_args()
+
+    source = generate(args.functions, args.depth, args.cases, args.terms,
+                      args.expr_terms, args.globals, args.seed)
+    if args.output == "-":
+        sys.stdout.write(source)
+    else:
+        with open(args.output, "w") as f:
+            f.write(source)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,18 @@
+/* Double arithmetic: pi by the midpoint rule on 4 / (1 + x^2) over [0, 1],
+   and the square root of 2 by Newton's method at every step. Input: the
+   number of steps n. */
+int main() {
+  int n;
+  read n;
+  double h = 1.0 / cast<double>(n);
+  double sum = 0.0;
+  double r = 1.0;
+  for (int i = 0; i < n; ++i) {
+    double x = (cast<double>(i) + 0.5) * h;
+    sum = sum + 4.0 / (1.0 + x * x);
+    r = (r + 2.0 / r) * 0.5;
+  }
+  write sum * h;
+  write r;
+  return 0;
+}
@@ -0,0 +1,18 @@
+#include <stdio.h>
+
+int main(void) {
+  int n;
+  if (scanf("%d", &n) != 1)
+    return 1;
+  double h = 1.0 / (double)n;
+  double sum = 0.0;
+  double r = 1.0;
+  for (int i = 0; i < n; ++i) {
+    double x = ((double)i + 0.5) * h;
+    sum = sum + 4.0 / (1.0 + x * x);
+    r = (r + 2.0 / r) * 0.5;
+  }
+  printf("%f\n", sum * h);
+  printf("%f\n", r);
+  return 0;
+}
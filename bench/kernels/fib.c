@@ -0,0 +1,13 @@
+/* Recursion: the naive Fibonacci function. Input: n. */
+int fib(int n) {
+  if (n < 2)
+    return n;
+  return fib(n - 1) + fib(n - 2);
+}
+
+int main() {
+  int n;
+  read n;
+  write fib(n);
+  return 0;
+}
@@ -0,0 +1,15 @@
+/* I/O: read n numbers below 100000 and write each one transformed, with a
+   running checksum at the end. Input: n, then the numbers. */
+int main() {
+  int n;
+  read n;
+  int sum = 0;
+  for (int i = 0; i < n; ++i) {
+    int v;
+    read v;
+    sum = (sum + v) % 1000003;
+    write v * 3 + 1;
+  }
+  write sum;
+  return 0;
+}
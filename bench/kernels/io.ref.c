@@ -0,0 +1,17 @@
+#include <stdio.h>
+
+int main(void) {
+  int n;
+  if (scanf("%d", &n) != 1)
+    return 1;
+  int sum = 0;
+  for (int i = 0; i < n; ++i) {
+    int v;
+    if (scanf("%d", &v) != 1)
+      return 1;
+    sum = (sum + v) % 1000003;
+    printf("%d\n", v * 3 + 1);
+  }
+  printf("%d\n", sum);
+  return 0;
+}
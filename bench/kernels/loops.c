@@ -0,0 +1,16 @@
+/* Nested loops: count the triples a < b < c <= n where c divides a*a + b*b.
+   Input: n, at most 1000. */
+int main() {
+  int n;
+  read n;
+  int count = 0;
+  for (int a = 1; a <= n; ++a)
+    for (int b = a + 1; b <= n; ++b) {
+      int s = a * a + b * b;
+      for (int c = b + 1; c <= n; ++c)
+        if (s % c == 0)
+          ++count;
+    }
+  write count;
+  return 0;
+}
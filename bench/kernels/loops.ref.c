@@ -0,0 +1,17 @@
+#include <stdio.h>
+
+int main(void) {
+  int n;
+  if (scanf("%d", &n) != 1)
+    return 1;
+  int count = 0;
+  for (int a = 1; a <= n; ++a)
+    for (int b = a + 1; b <= n; ++b) {
+      int s = a * a + b * b;
+      for (int c = b + 1; c <= n; ++c)
+        if (s % c == 0)
+          ++count;
+    }
+  printf("%d\n", count);
+  return 0;
+}
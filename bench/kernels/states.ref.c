@@ -0,0 +1,57 @@
+#include <stdio.h>
+
+int main(void) {
+  int n;
+  if (scanf("%d", &n) != 1)
+    return 1;
+  int x = 1;
+  int state = 0;
+  int count = 0;
+  for (int i = 0; i < n; ++i) {
+    x = (x * 1103 + 12345) % 65536;
+    int c = x / 16 % 4;
+    switch (state) {
+    case 0:
+      if (c == 0)
+        state = 1;
+      else
+        state = 2;
+      break;
+    case 1:
+      if (c < 2)
+        state = 3;
+      else
+        state = 0;
+      break;
+    case 2:
+      if (c == 3)
+        state = 4;
+      else if (c == 2)
+        state = 1;
+      break;
+    case 3:
+      state = c + 4;
+      break;
+    case 4:
+      if (c != 1)
+        state = 5;
+      else
+        state = 0;
+      break;
+    case 5:
+      if (c > 1)
+        state = 7;
+      else
+        state = 6;
+      break;
+    case 6:
+      state = c;
+      break;
+    default:
+      ++count;
+      state = 0;
+    }
+  }
+  printf("%d\n", count);
+  return 0;
+}
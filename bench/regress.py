@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+"""Track compile-time and run-time performance against a stored baseline.
+
+  record   run the benchmarks and store every sample in a baseline file
+  compare  run the same benchmarks again, with the settings stored in the
+           baseline, and compare every metric with it
+
+The compile suite is bench/compile_throughput.py, whose metrics are the time
+of each phase of each shape, its wall time and its peak resident set. The
+runtime suite is bench/runtime_perf.py, whose metrics are the times of each
+kernel in each mode and at each level.
+
+For every metric, compare prints the change of the mean and its 95%
+confidence interval, from Welch's t-test on the samples of both runs. A
+metric regresses if it gets worse by more than --threshold percent and the
+whole interval is above zero; it improves in the same way. Metrics whose
+baseline mean is below --min-ms milliseconds are too noisy to judge and are
+skipped. compare exits with status 1 if any metric regresses.
+
+The baseline file is JSON, with a format version, the commit it was recorded
+at, the settings of each suite and the samples of each metric.
+
+Usage: bench/regress.py record [--baseline FILE] [--cxc bin/main]
+                               [--suites compile,runtime] [--repeat N]
+                               [--compile-args ARGS] [--runtime-args ARGS]
+       bench/regress.py compare [--baseline FILE] [--cxc bin/main]
+                                [--threshold PERCENT] [--min-ms MS]
+"""
+
+import argparse
+import datetime
+import json
+import os
+import shlex
+import statistics
+import subprocess
+import sys
+import tempfile
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+
+# Version of the baseline file format.
+FORMAT = 1
+
+SUITES = {
+    "compile": "compile_throughput.py",
+    "runtime": "runtime_perf.py",
+}
+
+# Two-sided 95% quantiles of Student's t distribution, by degrees of freedom.
+T95 = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+       2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+       2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+       2.042]
+
+
+def t95(df):
+    if df < 1:
+        return T95[0]
+    if df > len(T95):
+        return 1.960
+    return T95[int(df) - 1]
+
+
+def run_suite(suite, cxc, args):
+    """Run a suite and return its JSON output."""
+    with tempfile.NamedTemporaryFile(suffix=".json", delete=False) as f:
+        path = f.name
+    try:
+        command = [sys.executable, os.path.join(BENCH_DIR, SUITES[suite]),
+                   "--cxc", cxc, "--json", path] + args
+        print("Running: " + " ".join(shlex.quote(a) for a in command),
+              file=sys.stderr)
+        # Its report goes to stderr, so that ours stays readable on stdout.
+        if subprocess.run(command, stdout=sys.stderr).returncode != 0:
+            sys.exit("Error: the %s suite failed" % suite)
+        with open(path) as f:
+            return json.load(f)
+    finally:
+        os.unlink(path)
+
+
+def compile_metrics(result):
+    metrics = {}
+    for shape, data in result["shapes"].items():
+        samples = data["samples"]
+        for phase in samples[0]["phases_ms"]:
+            metrics["compile %s: %s ms" % (shape, phase)] = \
+                [s["phases_ms"][phase] for s in samples]
+        metrics["compile %s: wall ms" % shape] = \
+            [s["wall_ms"] for s in samples]
+        # The peak after the last phase is the peak of the compilation.
+        metrics["compile %s: peak RSS KiB" % shape] = \
+            [list(s["peak_rss_kib"].values())[-1] for s in samples]
+    return metrics
+
+
+def runtime_metrics(result):
+    metrics = {}
+    for kernel, data in result["kernels"].items():
+        for run, samples in data["results"].items():
+            metrics["run %s: %s ms" % (kernel, run)] = samples
+    return metrics
+
+
+METRICS = {"compile": compile_metrics, "runtime": runtime_metrics}
+
+
+def git_commit():
+    proc = subprocess.run(["git", "-C", BENCH_DIR, "rev-parse", "HEAD"],
+                          stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                          universal_newlines=True)
+    commit = proc.stdout.strip() if proc.returncode == 0 else ""
+    if commit:
+        dirty = subprocess.run(["git", "-C", BENCH_DIR, "diff", "--quiet",
+                                "HEAD"]).returncode != 0
+        commit += "-dirty" if dirty else ""
+    return commit
+
+
+def measure(cxc, settings):
+    metrics = {}
+    for suite, args in settings.items():
+        metrics.update(METRICS[suite](run_suite(suite, cxc, args)))
+    return metrics
+
+
+def record(args):
+    settings = {}
+    for suite in [s for s in args.suites.split(",") if s]:
+        if suite not in SUITES:
+            sys.exit("Error: unknown suite '%s'; choose from %s" %
+                     (suite, ", ".join(SUITES)))
+        extra = args.compile_args if suite == "compile" else \
+            args.runtime_args
+        settings[suite] = ["--repeat", str(args.repeat)] + shlex.split(extra)
+
+    baseline = {
+        "format": FORMAT,
+        "commit": git_commit(),
+        "recorded": datetime.datetime.now().isoformat(timespec="seconds"),
+        "settings": settings,
+        "metrics": measure(args.cxc, settings),
+    }
+    directory = os.path.dirname(args.baseline)
+    if directory:
+        os.makedirs(directory, exist_ok=True)
+    with open(args.baseline, "w") as f:
+        json.dump(baseline, f, indent=2)
+    print("Recorded %d metrics in '%s'" %
+          (len(baseline["metrics"]), args.baseline))
+
+
+def welch(base, new):
+    """Change of the mean from base to new, and its 95% interval."""
+    m1, m2 = statistics.mean(base), statistics.mean(new)
+    v1 = statistics.variance(base) / len(base) if len(base) > 1 else 0.0
+    v2 = statistics.variance(new) / len(new) if len(new) > 1 else 0.0
+    se = (v1 + v2) ** 0.5
+    if se == 0:
+        return m2 - m1, m2 - m1, m2 - m1
+    df_den = 0.0
+    if len(base) > 1:
+        df_den += v1 * v1 / (len(base) - 1)
+    if len(new) > 1:
+        df_den += v2 * v2 / (len(new) - 1)
+    df = (v1 + v2) ** 2 / df_den
+    half = t95(df) * se
+    return m2 - m1, m2 - m1 - half, m2 - m1 + half
+
+
+def compare(args):
+    try:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+    except OSError as e:
+        sys.exit("Error: cannot read the baseline '%s': %s; record one "
+                 "first" % (args.baseline, e.strerror))
+    if baseline.get("format") != FORMAT:
+        sys.exit("Error: '%s' is in format %s, not %d; record it again" %
+                 (args.baseline, baseline.get("format"), FORMAT))
+
+    current = measure(args.cxc, baseline["settings"])
+
+    print("Baseline: %s, recorded %s at %s" %
+          (args.baseline, baseline["recorded"],
+           baseline["commit"] or "an unknown commit"))
+    print("Threshold: %.1f%%, 95%% confidence, metrics under %.1f ms "
+          "skipped\n" % (args.threshold, args.min_ms))
+    print("  %-40s %11s %11s %8s %20s" %
+          ("metric", "baseline", "now", "change", "95% interval"))
+
+    regressed, improved, skipped, missing = [], [], 0, []
+    for name, base in baseline["metrics"].items():
+        if name not in current:
+            missing.append(name)
+            continue
+        new = current[name]
+        m1 = statistics.mean(base)
+        if name.endswith(" ms") and m1 < args.min_ms:
+            skipped += 1
+            continue
+        if m1 == 0:
+            continue
+        change, low, high = welch(base, new)
+        pct, low_pct, high_pct = (change / m1 * 100, low / m1 * 100,
+                                  high / m1 * 100)
+        verdict = ""
+        if pct > args.threshold and low_pct > 0:
+            verdict = "REGRESSED"
+            regressed.append(name)
+        elif pct < -args.threshold and high_pct < 0:
+            verdict = "improved"
+            improved.append(name)
+        print("  %-40s %11.2f %11.2f %+7.1f%% [%+7.1f%%, %+7.1f%%] %s" %
+              (name, m1, statistics.mean(new), pct, low_pct, high_pct,
+               verdict))
+
+    print()
+    if missing:
+        print("Not measured now: " + ", ".join(missing))
+    print("%d regressed, %d improved, %d skipped as too small" %
+          (len(regressed), len(improved), skipped))
+    for name in regressed:
+        print("  regressed: " + name)
+    for name in improved:
+        print("  improved: " + name)
+    return 1 if regressed else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    commands = parser.add_subparsers(dest="command")
+    commands.required = True
+
+    for name in ["record", "compare"]:
+        sub = commands.add_parser(name)
+        sub.add_argument("--baseline",
+                         default=os.path.join(BENCH_DIR, "baselines",
+                                              "baseline.json"),
+                         help="baseline file (default: "
+                              "bench/baselines/baseline.json)")
+        sub.add_argument("--cxc", default="bin/main",
+                         help="compiler to measure (default: bin/main)")
+        if name == "record":
+            sub.add_argument("--suites", default=",".join(SUITES),
+                             help="comma-separated suites (default: all)")
+            sub.add_argument("--repeat", type=int, default=5,
+                             help="samples of every metric (default: 5)")
+            sub.add_argument("--compile-args", default="",
+                             help="more options of compile_throughput.py")
+            sub.add_argument("--runtime-args", default="",
+                             help="more options of runtime_perf.py")
+        else:
+            sub.add_argument("--threshold", type=float, default=5.0,
+                             help="percent a metric may get worse by "
+                                  "(default: 5)")
+            sub.add_argument("--min-ms", type=float, default=1.0,
+                             help="smallest baseline time judged "
+                                  "(default: 1)")
+    args = parser.parse_args()
+
+    if not os.access(args.cxc, os.X_OK):
+        sys.exit("Error: cannot execute '%s'; run make first" % args.cxc)
+    args.cxc = os.path.abspath(args.cxc)
+    if args.command == "record":
+        if args.repeat < 2:
+            sys.exit("Error: --repeat must be at least 2 for confidence "
+                     "intervals")
+        record(args)
+        return 0
+    return compare(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
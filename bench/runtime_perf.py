@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+"""Measure how fast compiled CX programs run, in every execution mode.
+
+Each kernel in bench/kernels is a CPU-bound CX program, NAME.c, with the same
+program in C next to it, NAME.ref.c:
+
+  fib      recursion
+  loops    nested loops
+  states   a switch-driven state machine
+  doubles  double arithmetic
+  io       reading and writing many numbers
+
+Every kernel is run at each optimization level in each mode:
+
+  lli      the IR from --emit=llvm, run by lli with the runtime loaded
+  native   an executable linked by cxc
+  jit      cxc --run, which compiles the kernel on every run
+  c        the C version, compiled by clang (or cc if there is none)
+
+Runs are pinned to one CPU, and --warmup runs are made and thrown away before
+--repeat timed ones. Times are wall times of the whole process, so lli and
+jit include compiling the kernel. Every output must match the first one,
+that of the C version if it is run; the median of each mode is compared with
+the C version at the same level.
+
+Usage: bench/runtime_perf.py [--cxc bin/main] [--cc CC] [--lli LLI]
+                             [--kernels a,b,...] [--modes a,b,...]
+                             [--levels 0,1,2,3] [--scale X] [--warmup N]
+                             [--repeat N] [--cpu N | --no-pin] [--json FILE]
+"""
+
+import argparse
+import json
+import math
+import os
+import random
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+KERNEL_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          "kernels")
+
+PHI = (1 + 5 ** 0.5) / 2
+
+# The input size of each kernel at a scale, growing its work by that scale.
+SIZES = {
+    "fib": lambda scale: 30 + round(math.log(scale, PHI)),
+    "loops": lambda scale: round(300 * scale ** (1 / 3)),
+    "states": lambda scale: round(10000000 * scale),
+    "doubles": lambda scale: round(10000000 * scale),
+    "io": lambda scale: round(300000 * scale),
+}
+
+MODES = ["lli", "native", "jit", "c"]
+
+
+def kernel_input(name, size):
+    if name != "io":
+        return ("%d\n" % size).encode()
+    rng = random.Random(1)
+    numbers = "\n".join(str(rng.randrange(100000)) for _ in range(size))
+    return ("%d\n%s\n" % (size, numbers)).encode()
+
+
+def check_call(args):
+    proc = subprocess.run(args, stdout=subprocess.PIPE,
+                          stderr=subprocess.STDOUT)
+    if proc.returncode != 0:
+        sys.exit("Error: '%s' failed:\n%s" %
+                 (" ".join(args), proc.stdout.decode()[-2000:]))
+
+
+def build(args, name, level, tmp):
+    """Build what every mode runs, and return the command of each."""
+    source = os.path.join(KERNEL_DIR, name + ".c")
+    reference = os.path.join(KERNEL_DIR, name + ".ref.c")
+    stem = os.path.join(tmp, "%s.O%d" % (name, level))
+    opt = "-O%d" % level
+    commands = {}
+    if "lli" in args.modes:
+        check_call([args.cxc, opt, "--emit=llvm", "-o", stem + ".ll",
+                    source])
+        commands["lli"] = [args.lli, opt, "-load", args.runtime,
+                           stem + ".ll"]
+    if "native" in args.modes:
+        check_call([args.cxc, opt, "-o", stem + ".exe", source])
+        commands["native"] = [stem + ".exe"]
+    if "jit" in args.modes:
+        commands["jit"] = [args.cxc, opt, "--run", source]
+    if "c" in args.modes:
+        check_call([args.cc, opt, "-o", stem + ".ref.exe", reference])
+        commands["c"] = [stem + ".ref.exe"]
+    return commands
+
+
+def run_once(command, stdin, cpu):
+    pin = (lambda: os.sched_setaffinity(0, {cpu})) if cpu is not None \
+        else None
+    start = time.perf_counter()
+    proc = subprocess.run(command, input=stdin, stdout=subprocess.PIPE,
+                          stderr=subprocess.PIPE, preexec_fn=pin)
+    elapsed = time.perf_counter() - start
+    if proc.returncode != 0:
+        sys.exit("Error: '%s' failed with status %d:\n%s" %
+                 (" ".join(command), proc.returncode,
+                  proc.stderr.decode()[-2000:]))
+    return elapsed * 1e3, proc.stdout
+
+
+def measure(command, stdin, args):
+    output = None
+    for _ in range(args.warmup):
+        _, output = run_once(command, stdin, args.cpu)
+    samples = []
+    for _ in range(args.repeat):
+        ms, output = run_once(command, stdin, args.cpu)
+        samples.append(ms)
+    return samples, output
+
+
+def rsd(samples):
+    """Relative standard deviation, in percent."""
+    if len(samples) < 2:
+        return 0.0
+    return statistics.stdev(samples) / statistics.mean(samples) * 100
+
+
+def run_kernel(args, name, tmp):
+    size = SIZES[name](args.scale)
+    stdin = kernel_input(name, size)
+    print("%s (input %d)" % (name, size))
+    print("  %-8s %5s %11s %9s %6s %8s" %
+          ("mode", "level", "median ms", "min ms", "rsd", "vs C"))
+
+    results, reference, failed = {}, None, False
+    for level in args.levels:
+        commands = build(args, name, level, tmp)
+        medians = {}
+        # C first, so that every other mode can be compared with it.
+        for mode in sorted(commands, key=lambda m: m != "c"):
+            samples, output = measure(commands[mode], stdin, args)
+            if reference is None:
+                reference = output
+            same = output == reference
+            failed |= not same
+            results["%s -O%d" % (mode, level)] = samples
+            medians[mode] = statistics.median(samples)
+            ratio = ("%7.2fx" % (medians[mode] / medians["c"])
+                     if "c" in medians else "")
+            print("  %-8s %5s %11.2f %9.2f %5.1f%% %8s%s" %
+                  (mode, "-O%d" % level, medians[mode], min(samples),
+                   rsd(samples), ratio, "" if same else "  OUTPUT DIFFERS"))
+    print()
+    return {"input": size, "results": results}, failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cxc", default="bin/main",
+                        help="compiler to measure (default: bin/main)")
+    parser.add_argument("--cc", default=shutil.which("clang") or "cc",
+                        help="C compiler of the baseline (default: clang, "
+                             "or cc if there is none)")
+    parser.add_argument("--lli", default="lli", help="lli to run IR with")
+    parser.add_argument("--kernels", default=",".join(SIZES),
+                        help="comma-separated kernels (default: all)")
+    parser.add_argument("--modes", default=",".join(MODES),
+                        help="comma-separated modes (default: all)")
+    parser.add_argument("--levels", default="0,1,2,3",
+                        help="comma-separated optimization levels")
+    parser.add_argument("--scale", type=float, default=1.0,
+                        help="factor on the work of every kernel")
+    parser.add_argument("--warmup", type=int, default=1,
+                        help="untimed runs before the timed ones")
+    parser.add_argument("--repeat", type=int, default=5,
+                        help="timed runs per kernel, mode and level")
+    parser.add_argument("--cpu", type=int,
+                        default=max(os.sched_getaffinity(0)),
+                        help="CPU to pin runs to (default: the last one)")
+    parser.add_argument("--no-pin", dest="cpu", action="store_const",
+                        const=None, help="do not pin runs to a CPU")
+    parser.add_argument("--json", metavar="FILE",
+                        help="also write every sample to FILE as JSON")
+    args = parser.parse_args()
+
+    if not os.access(args.cxc, os.X_OK):
+        sys.exit("Error: cannot execute '%s'; run make first" % args.cxc)
+    args.cxc = os.path.abspath(args.cxc)
+    args.runtime = os.path.join(os.path.dirname(args.cxc), "libcxrt.so")
+    args.kernels = [k for k in args.kernels.split(",") if k]
+    args.modes = [m for m in args.modes.split(",") if m]
+    args.levels = [int(l) for l in args.levels.split(",") if l]
+    for k in args.kernels:
+        if k not in SIZES:
+            sys.exit("Error: unknown kernel '%s'; choose from %s" %
+                     (k, ", ".join(SIZES)))
+    for m in args.modes:
+        if m not in MODES:
+            sys.exit("Error: unknown mode '%s'; choose from %s" %
+                     (m, ", ".join(MODES)))
+    for l in args.levels:
+        if l not in range(4):
+            sys.exit("Error: invalid optimization level %d" % l)
+    if args.repeat < 1:
+        sys.exit("Error: --repeat must be at least 1")
+    if "lli" in args.modes and not shutil.which(args.lli):
+        sys.exit("Error: cannot find '%s'; pass --lli or leave lli out of "
+                 "--modes" % args.lli)
+
+    print("Run time of CX kernels, %d runs after %d warmup, %s; C by %s\n" %
+          (args.repeat, args.warmup,
+           "pinned to CPU %d" % args.cpu if args.cpu is not None
+           else "not pinned", args.cc))
+    kernels, failed = {}, False
+    with tempfile.TemporaryDirectory() as tmp:
+        for name in args.kernels:
+            kernels[name], differs = run_kernel(args, name, tmp)
+            failed |= differs
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"cc": args.cc, "scale": args.scale,
+                       "warmup": args.warmup, "kernels": kernels}, f,
+                      indent=2)
+    if failed:
+        sys.exit("Error: some outputs differ from the C version")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Measure how compile time scales with block nesting depth and local count.
+
+Two families of programs are generated:
+
+  depth   DEPTH nested blocks, each declaring LOCALS variables and reading
+          every variable of the enclosing block.
+  locals  a fixed number of nested blocks, each declaring a growing number of
+          variables.
+
+Both grow the program linearly, so the time per generated line should stay
+flat as the size doubles. A symbol table that copies its scopes on every block
+entry shows up as a time per line that doubles along with the depth.
+
+Usage: bench/scope_scaling.py [--cxc bin/main] [--repeat N]
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def generate(depth, locals_per_block):
+    lines = ["int main() {"]
+    for d in range(depth):
+        indent = "  " * (d + 1)
+        lines.append(indent + "{")
+        for j in range(locals_per_block):
+            init = "v%dx%d + 1" % (d - 1, j) if d > 0 else str(j)
+            lines.append(indent + "  int v%dx%d = %s;" % (d, j, init))
+    lines.append("  " * (depth + 1) + "write v%dx0;" % (depth - 1))
+    for d in reversed(range(depth)):
+        lines.append("  " * (d + 1) + "}")
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+
+def compile_time(cxc, source, repeat):
+    with tempfile.NamedTemporaryFile("w", suffix=".c", delete=False) as f:
+        f.write(source)
+        path = f.name
+    try:
+        best = None
+        for _ in range(repeat):
+            start = time.perf_counter()
+            proc = subprocess.run(
+                [cxc, "--emit=llvm", "-o", os.devnull, path],
+                stderr=subprocess.PIPE, universal_newlines=True)
+            if proc.returncode != 0:
+                sys.exit("Error: '%s' failed:\n%s" %
+                         (cxc, proc.stderr[-2000:]))
+            elapsed = time.perf_counter() - start
+            best = elapsed if best is None else min(best, elapsed)
+        return best
+    finally:
+        os.unlink(path)
+
+
+def sweep(cxc, title, shapes, repeat):
+    print("%s:" % title)
+    print("  %6s %6s %8s %10s %12s" %
+          ("depth", "locals", "lines", "time (s)", "us / line"))
+    for depth, locals_per_block in shapes:
+        source = generate(depth, locals_per_block)
+        lines = source.count("\n")
+        t = compile_time(cxc, source, repeat)
+        print("  %6d %6d %8d %10.3f %12.2f" %
+              (depth, locals_per_block, lines, t, t * 1e6 / lines))
+    print()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cxc", default="bin/main",
+                        help="compiler to measure (default: bin/main)")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="runs per program, the fastest is kept")
+    args = parser.parse_args()
+
+    if not os.access(args.cxc, os.X_OK):
+        sys.exit("Error: cannot execute '%s'; run make first" % args.cxc)
+
+    sweep(args.cxc, "Nesting depth (8 locals per block)",
+          [(d, 8) for d in (250, 500, 1000, 2000)], args.repeat)
+    sweep(args.cxc, "Locals per block (64 nested blocks)",
+          [(64, n) for n in (32, 64, 128, 256)], args.repeat)
+
+
+if __name__ == "__main__":
+    main()
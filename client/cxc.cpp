@@ -0,0 +1,91 @@
+// Thin client of the compile server. It takes the same arguments as the
+// compiler, and has the server compile in its working directory with its
+// standard streams, so that it can stand in for the compiler. See
+// `server.h`.
+
+#include "server.h"
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+int main(int argc, char **argv) {
+  std::string Path = GetServerSocketPath();
+  sockaddr_un Addr = {};
+  Addr.sun_family = AF_UNIX;
+  if (Path.size() >= sizeof(Addr.sun_path)) {
+    fprintf(stderr, "Error: socket path '%s' is too long\n", Path.c_str());
+    return 1;
+  }
+  strcpy(Addr.sun_path, Path.c_str());
+
+  int Conn = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (Conn < 0 || connect(Conn, (sockaddr *)&Addr, sizeof(Addr))) {
+    fprintf(stderr,
+            "Error: cannot connect to the server at '%s': %s\n"
+            "Start one with 'main --server'.\n",
+            Path.c_str(), strerror(errno));
+    return 1;
+  }
+  // Our sources and standard streams must not go to someone else's server.
+  if (!IsPeerSameUser(Conn)) {
+    fprintf(stderr,
+            "Error: the server at '%s' is not run by the same user\n",
+            Path.c_str());
+    return 1;
+  }
+
+  char Cwd[PATH_MAX];
+  if (!getcwd(Cwd, sizeof(Cwd))) {
+    fprintf(stderr, "Error: cannot get the working directory: %s\n",
+            strerror(errno));
+    return 1;
+  }
+  std::string Request(Cwd, strlen(Cwd) + 1);
+  for (int i = 1; i < argc; ++i)
+    Request.append(argv[i], strlen(argv[i]) + 1);
+
+  // The size goes first, with the standard streams attached to it.
+  uint32_t Size = Request.size();
+  int FDs[3] = {0, 1, 2};
+  char Control[CMSG_SPACE(sizeof(FDs))] = {};
+  iovec IOV = {&Size, sizeof(Size)};
+  msghdr Msg = {};
+  Msg.msg_iov = &IOV;
+  Msg.msg_iovlen = 1;
+  Msg.msg_control = Control;
+  Msg.msg_controllen = sizeof(Control);
+  cmsghdr *C = CMSG_FIRSTHDR(&Msg);
+  C->cmsg_level = SOL_SOCKET;
+  C->cmsg_type = SCM_RIGHTS;
+  C->cmsg_len = CMSG_LEN(sizeof(FDs));
+  memcpy(CMSG_DATA(C), FDs, sizeof(FDs));
+
+  bool Sent = sendmsg(Conn, &Msg, 0) == sizeof(Size);
+  for (size_t Done = 0; Sent && Done < Request.size();) {
+    ssize_t N = write(Conn, Request.data() + Done, Request.size() - Done);
+    if (N < 0 && errno == EINTR)
+      continue;
+    Sent = N > 0;
+    Done += Sent ? N : 0;
+  }
+
+  int32_t Status;
+  size_t Got = 0;
+  while (Sent && Got < sizeof(Status)) {
+    ssize_t N = read(Conn, (char *)&Status + Got, sizeof(Status) - Got);
+    if (N < 0 && errno == EINTR)
+      continue;
+    if (N <= 0)
+      break;
+    Got += N;
+  }
+  if (Got != sizeof(Status)) {
+    fprintf(stderr, "Error: the server at '%s' went away\n", Path.c_str());
+    return 1;
+  }
+  return Status;
+}
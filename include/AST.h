@@ -1,12 +1,16 @@
 #pragma once
 
+#include "memreport.h"
+#include "symbol.h"
 #include <algorithm>
 #include <cwchar>
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/StringExtras.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
+#include <llvm/Support/Allocator.h>
 #include <map>
 #include <memory>
 #include <string>
@@ -16,28 +20,96 @@ using namespace llvm;
 
 // namespace {
 
+/**
+ * Bump allocator for AST nodes. Nodes and child lists live in the arena until
+ * `reset()` releases all of them at once; destructors are never run, so nodes
+ * only hold raw pointers to other nodes and `ArrayRef`s into the arena.
+ */
+class ASTArena {
+  BumpPtrAllocator Alloc;
+
+public:
+  /**
+   * @brief Allocate and construct a node.
+   * @return The new node.
+   */
+  template <typename T, typename... ArgTs> T *create(ArgTs &&...Args) {
+    if (MemReportEnabled)
+      CountASTNode(getASTClassID<T>(), sizeof(T));
+    return new (Alloc.Allocate<T>()) T(std::forward<ArgTs>(Args)...);
+  }
+  /**
+   * @brief Copy a list of children into the arena.
+   * @param Elems The list, usually a temporary vector of the parser.
+   * @return A slice of the arena holding a copy of the list.
+   */
+  template <typename T> ArrayRef<T> copy(ArrayRef<T> Elems) {
+    if (Elems.empty())
+      return ArrayRef<T>();
+    if (MemReportEnabled)
+      CountASTNode(getASTListID(), sizeof(T) * Elems.size());
+    T *Buf = Alloc.Allocate<T>(Elems.size());
+    std::uninitialized_copy(Elems.begin(), Elems.end(), Buf);
+    return ArrayRef<T>(Buf, Elems.size());
+  }
+  /**
+   * @brief Release every node at once.
+   */
+  void reset() { Alloc.Reset(); }
+  /**
+   * @brief Get the number of bytes handed out since the last reset.
+   * @return Number of bytes.
+   */
+  size_t getBytesAllocated() const { return Alloc.getBytesAllocated(); }
+};
+
 /**
  * @brief Types in CX language.
  */
 enum CXType { typ_err = 0, typ_int, typ_bool, typ_double };
 
+/**
+ * @brief Get the spelling of a CX type.
+ * @return Its keyword, such as `"int"`.
+ */
+const char *getCXTypeName(const enum CXType T);
+
 /**
  * @brief Convert CX types to LLVM types.
  * @return The corresponding LLVM type.
  */
 Type *llvmTypeFromCXType(const enum CXType T);
 
+class VarDeclAST;
+class PrototypeAST;
+
+/**
+ * @brief Kinds of expression AST nodes, for `isa<>`, `cast<>` and `dyn_cast<>`.
+ */
+enum ExprKind {
+  expr_int = 0,
+  expr_double,
+  expr_boolean,
+  expr_variable,
+  expr_unary,
+  expr_binary,
+  expr_call,
+  expr_cast
+};
+
 /**
  * @brief Expression AST node.
  */
 class ExprAST {
-  enum CXType ExprType;
+  const enum ExprKind Kind;
+  enum CXType ExprType = typ_err;
 
 protected:
   /**
    * @brief Constructor.
+   * @param Kind Kind of the concrete node.
    */
-  ExprAST() {}
+  ExprAST(enum ExprKind Kind) : Kind(Kind) {}
   // ExprAST(enum CXType ExprType) : ExprType(ExprType) {}
 
   /**
@@ -47,9 +119,14 @@ protected:
   void setCXType(enum CXType ExprType) { this->ExprType = ExprType; }
 
 public:
+  /**
+   * @brief Get the kind of this node.
+   * @return Its kind.
+   */
+  enum ExprKind getKind() const { return Kind; }
   /**
    * @brief Get CX type of this expression.
-   * @return CX type.
+   * @return CX type, which is `typ_err` until `sema()` succeeds.
    */
   enum CXType getCXType() { return ExprType; }
   /**
@@ -57,40 +134,88 @@ public:
    */
   virtual ~ExprAST() = default;
   /**
-   * @brief Generate IR.
+   * @brief Resolve names and check types, recording the CX type of this
+   * expression and of its subexpressions.
+   * @return CX type of this expression, or `typ_err` if it is ill-formed.
+   */
+  virtual enum CXType sema() = 0;
+  /**
+   * @brief Generate IR. Only valid after `sema()` succeeds.
    * @return LLVM Value of this AST.
    */
   virtual Value *codegen() = 0;
 };
 
+/**
+ * @brief Kinds of block elements, for `isa<>`, `cast<>` and `dyn_cast<>`.
+ * Every kind but `elem_vardecl` is a statement.
+ */
+enum BlockElemKind {
+  elem_vardecl = 0,
+  elem_expr,
+  elem_block,
+  elem_if,
+  elem_for,
+  elem_switch,
+  elem_while,
+  elem_do,
+  elem_until,
+  elem_read,
+  elem_write,
+  elem_cont,
+  elem_brk,
+  elem_ret,
+  elem_exit
+};
+
 /**
  * Class for representing elements in a block statement. It can either be a
  * *statement* or a *local variable declaration*.
  */
 class BlockElemAST {
+  const enum BlockElemKind Kind;
+
+protected:
   /**
-   * @brief Is this a declaration or not?
-   * @return True if yes and false if no.
+   * @brief Constructor.
+   * @param Kind Kind of the concrete node.
    */
-  virtual bool isVarDecl() = 0;
+  BlockElemAST(enum BlockElemKind Kind) : Kind(Kind) {}
+
+public:
+  /**
+   * @brief Get the kind of this node.
+   * @return Its kind.
+   */
+  enum BlockElemKind getKind() const { return Kind; }
 };
 
 /**
  * @brief Statement AST node.
  */
 class StmtAST : public BlockElemAST {
+protected:
+  using BlockElemAST::BlockElemAST;
+
 public:
   /**
    * @brief Destructor
    */
   virtual ~StmtAST() = default;
+  /**
+   * @brief Resolve names and check types in this statement.
+   * @return 0 if nothing goes wrong; 1 otherwise.
+   */
+  virtual int sema() = 0;
   /**
    * @brief Generate IR
    * @return LLVM Value of this AST. It is a null value of type void if nothing
    * goes wrong and is nullptr otherwise.
    */
   virtual Value *codegen() = 0;
-  bool isVarDecl() override { return false; }
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() != elem_vardecl;
+  }
 };
 
 /**
@@ -101,13 +226,17 @@ class ExprStmtAST : public StmtAST {
   /**
    * @brief The expression in this statement. Can be nullptr.
    */
-  std::unique_ptr<ExprAST> Expr;
+  ExprAST *Expr;
 
 public:
   /**
    * @brief Constructor.
    */
-  ExprStmtAST(std::unique_ptr<ExprAST> Expr) : Expr(std::move(Expr)) {}
+  ExprStmtAST(ExprAST *Expr) : StmtAST(elem_expr), Expr(Expr) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_expr;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -124,7 +253,16 @@ public:
   /**
    * @brief Constructor.
    */
-  IntExprAST(unsigned Val) : Val(Val) {}
+  IntExprAST(unsigned Val) : ExprAST(expr_int), Val(Val) {}
+  static bool classof(const ExprAST *E) {
+    return E->getKind() == expr_int;
+  }
+  /**
+   * @brief Get the value.
+   * @return The value.
+   */
+  unsigned getVal() const { return Val; }
+  enum CXType sema() override;
   Value *codegen() override;
 };
 
@@ -141,7 +279,16 @@ public:
   /**
    * @brief Constructor.
    */
-  DoubleExprAST(double Val) : Val(Val) {}
+  DoubleExprAST(double Val) : ExprAST(expr_double), Val(Val) {}
+  static bool classof(const ExprAST *E) {
+    return E->getKind() == expr_double;
+  }
+  /**
+   * @brief Get the value.
+   * @return The value.
+   */
+  double getVal() const { return Val; }
+  enum CXType sema() override;
   Value *codegen() override;
 };
 
@@ -153,13 +300,22 @@ class BooleanExprAST : public ExprAST {
    * The parsed boolean value.
    */
   bool Val;
+  enum CXType sema() override;
   Value *codegen() override;
 
 public:
   /**
    * @brief Constructor.
    */
-  BooleanExprAST(bool Val) : Val(Val) {}
+  BooleanExprAST(bool Val) : ExprAST(expr_boolean), Val(Val) {}
+  static bool classof(const ExprAST *E) {
+    return E->getKind() == expr_boolean;
+  }
+  /**
+   * @brief Get the value.
+   * @return The value.
+   */
+  bool getVal() const { return Val; }
 };
 
 /**
@@ -170,18 +326,32 @@ class VariableExprAST : public ExprAST {
   /**
    * @brief Variable name.
    */
-  std::string Name;
+  SymbolID Name;
+  /**
+   * @brief Declaration of the local variable the name refers to, found by
+   * `sema()`. nullptr if it refers to a global variable.
+   */
+  VarDeclAST *Decl = nullptr;
 
 public:
   /**
    * @brief Constructor.
    */
-  VariableExprAST(const std::string &Name) : Name(Name) {}
+  VariableExprAST(SymbolID Name) : ExprAST(expr_variable), Name(Name) {}
+  static bool classof(const ExprAST *E) {
+    return E->getKind() == expr_variable;
+  }
   /**
    * @brief Get variable name.
    * @return Variable name.
    */
-  const std::string getName() const { return Name; }
+  SymbolID getName() const { return Name; }
+  /**
+   * @brief Get the declaration of the local variable.
+   * @return The declaration, or nullptr for a global variable.
+   */
+  VarDeclAST *getDecl() const { return Decl; }
+  enum CXType sema() override;
   Value *codegen() override;
 };
 
@@ -189,14 +359,18 @@ public:
  * @brief Block statement AST node.
  */
 class BlockStmtAST : public StmtAST {
-  std::vector<std::unique_ptr<BlockElemAST>> Elems;
+  ArrayRef<BlockElemAST *> Elems;
 
 public:
   /**
    * @brief Constructor
    */
-  BlockStmtAST(std::vector<std::unique_ptr<BlockElemAST>> Elems)
-      : Elems(std::move(Elems)) {}
+  BlockStmtAST(ArrayRef<BlockElemAST *> Elems)
+      : StmtAST(elem_block), Elems(Elems) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_block;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -213,14 +387,28 @@ class UnaryExprAST : public ExprAST {
   /**
    * @brief Operand of the unary operation.
    */
-  std::unique_ptr<ExprAST> Operand;
+  ExprAST *Operand;
 
 public:
   /**
    * @brief Constructor.
    */
-  UnaryExprAST(int Opcode, std::unique_ptr<ExprAST> Operand)
-      : Opcode(Opcode), Operand(std::move(Operand)) {}
+  UnaryExprAST(int Opcode, ExprAST *Operand)
+      : ExprAST(expr_unary), Opcode(Opcode), Operand(Operand) {}
+  static bool classof(const ExprAST *E) {
+    return E->getKind() == expr_unary;
+  }
+  /**
+   * @brief Get the unary operator.
+   * @return The operator.
+   */
+  int getOpcode() const { return Opcode; }
+  /**
+   * @brief Get the operand.
+   * @return The operand.
+   */
+  ExprAST *getOperand() const { return Operand; }
+  enum CXType sema() override;
   Value *codegen() override;
 };
 
@@ -235,15 +423,46 @@ class BinaryExprAST : public ExprAST {
   /**
    * @brief Left hand side operand and right hand side operand.
    */
-  std::unique_ptr<ExprAST> LHS, RHS;
+  ExprAST *LHS, *RHS;
+
+  /**
+   * @brief Check the operator itself, other than `=`.
+   * @param L CX type of the left hand side operand, already checked.
+   * @return CX type of this expression, or `typ_err` if it is ill-formed.
+   */
+  enum CXType semaOperator(enum CXType L);
+  /**
+   * @brief Generate IR for the operator itself, other than `=`.
+   * @param L Value of the left hand side operand, already generated.
+   * @return LLVM Value of this AST.
+   */
+  Value *codegenOperator(Value *L);
 
 public:
   /**
    * @brief Constructor.
    */
-  BinaryExprAST(int Op, std::unique_ptr<ExprAST> LHS,
-                std::unique_ptr<ExprAST> RHS)
-      : Op(Op), LHS(std::move(LHS)), RHS(std::move(RHS)) {}
+  BinaryExprAST(int Op, ExprAST *LHS, ExprAST *RHS)
+      : ExprAST(expr_binary), Op(Op), LHS(LHS), RHS(RHS) {}
+  static bool classof(const ExprAST *E) {
+    return E->getKind() == expr_binary;
+  }
+  /**
+   * @brief Get the binary operator.
+   * @return The operator.
+   */
+  int getOp() const { return Op; }
+  /**
+   * @brief Get the left hand side operand.
+   * @return The operand.
+   */
+  ExprAST *getLHS() const { return LHS; }
+  /**
+   * @brief Get the right hand side operand.
+   * @return The operand.
+   */
+  ExprAST *getRHS() const { return RHS; }
+  enum CXType sema() override;
   Value *codegen() override;
 };
 
@@ -254,33 +473,66 @@ class CallExprAST : public ExprAST {
   /**
    * @brief Callee's name.
    */
-  std::string Callee;
+  SymbolID Callee;
   /**
    * @brief Arguments of function call.
    */
-  std::vector<std::unique_ptr<ExprAST>> Args;
+  ArrayRef<ExprAST *> Args;
+  /**
+   * @brief Prototype of the callee, found by `sema()`.
+   */
+  PrototypeAST *Proto = nullptr;
 
 public:
   /**
    * @brief Constructor.
    */
-  CallExprAST(const std::string &Callee,
-              std::vector<std::unique_ptr<ExprAST>> Args)
-      : Callee(Callee), Args(std::move(Args)) {}
+  CallExprAST(SymbolID Callee, ArrayRef<ExprAST *> Args)
+      : ExprAST(expr_call), Callee(Callee), Args(Args) {}
+  static bool classof(const ExprAST *E) {
+    return E->getKind() == expr_call;
+  }
+  enum CXType sema() override;
   Value *codegen() override;
 };
 
+/**
+ * @brief Kinds of declaration AST nodes, for `isa<>`, `cast<>` and
+ * `dyn_cast<>`.
+ */
+enum DeclKind { decl_var = 0, decl_globvar, decl_prototype, decl_function };
+
 /**
  * @brief Declaration AST node.
  */
 class DeclAST {
+  const enum DeclKind Kind;
+
+protected:
+  /**
+   * @brief Constructor.
+   * @param Kind Kind of the concrete node.
+   */
+  DeclAST(enum DeclKind Kind) : Kind(Kind) {}
+
 public:
+  /**
+   * @brief Get the kind of this node.
+   * @return Its kind.
+   */
+  enum DeclKind getKind() const { return Kind; }
   /**
    * @brief Destructor.
    */
   ~DeclAST() = default;
   /**
-   * @brief Generate IR.
+   * @brief Resolve names and check types in this declaration, and record
+   * what it declares for the declarations after it.
+   * @return 0 if nothing goes wrong; 1 otherwise.
+   */
+  virtual int sema() = 0;
+  /**
+   * @brief Generate IR. Only valid after `sema()` succeeds.
    * @return Created LLVM function if this is a function declaration. A null
    * value of type void otherwise.
    */
@@ -289,7 +541,7 @@ public:
    * @brief Is this a variable declaration?
    * @return True if yes and false if no.
    */
-  virtual bool isVarDecl() = 0;
+  bool isVarDecl() const { return Kind == decl_var || Kind == decl_globvar; }
 };
 
 /**
@@ -308,19 +560,32 @@ protected:
   /**
    * @brief Variable name.
    */
-  std::string Name;
+  SymbolID Name;
   /**
    * @brief Initial value. Can be nullptr.
    */
-  std::unique_ptr<ExprAST> Val;
+  ExprAST *Val;
+
+  /**
+   * @brief Constructor for subclasses.
+   */
+  VarDeclAST(enum DeclKind Kind, bool isConst, const enum CXType Type,
+             SymbolID Name, ExprAST *Val)
+      : BlockElemAST(elem_vardecl), DeclAST(Kind), isConst(isConst),
+        Type(Type), Name(Name), Val(Val) {}
 
 public:
   /**
    * @brief Constructor.
    */
-  VarDeclAST(bool isConst, const enum CXType Type, const std::string &Name,
-             std::unique_ptr<ExprAST> Val)
-      : isConst(isConst), Type(Type), Name(Name), Val(std::move(Val)) {}
+  VarDeclAST(bool isConst, const enum CXType Type, SymbolID Name,
+             ExprAST *Val)
+      : VarDeclAST(decl_var, isConst, Type, Name, Val) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_vardecl;
+  }
+  static bool classof(const DeclAST *D) { return D->isVarDecl(); }
+  int sema() override;
   Function *codegen() override;
   /**
    * @brief See if this is a constant variable.
@@ -336,8 +601,7 @@ public:
    * @brief Get the variable's name.
    * @return Its name.
    */
-  const std::string &getName() const { return Name; }
-  bool isVarDecl() override { return true; }
+  SymbolID getName() const { return Name; }
 
   /**
    * @brief Override operator `==`
@@ -355,9 +619,17 @@ public:
  * @brief Global variable declaration AST node.
  */
 class GlobVarDeclAST : public VarDeclAST {
-  using VarDeclAST::VarDeclAST;
-
 public:
+  /**
+   * @brief Constructor.
+   */
+  GlobVarDeclAST(bool isConst, const enum CXType Type, SymbolID Name,
+                 ExprAST *Val)
+      : VarDeclAST(decl_globvar, isConst, Type, Name, Val) {}
+  static bool classof(const DeclAST *D) {
+    return D->getKind() == decl_globvar;
+  }
+  int sema() override;
   Function *codegen() override;
 };
 
@@ -372,25 +644,28 @@ class PrototypeAST : public DeclAST {
   /**
    * @brief Function name.
    */
-  std::string Name;
+  SymbolID Name;
   /**
    * @brief Function parameters.
    */
-  std::vector<std::unique_ptr<VarDeclAST>> Args;
+  ArrayRef<VarDeclAST *> Args;
 
 public:
   /**
    * @brief Constructor.
    */
-  PrototypeAST(const enum CXType RetTyp, const std::string &Name,
-               std::vector<std::unique_ptr<VarDeclAST>> Args)
-      : RetTyp(RetTyp), Name(Name), Args(std::move(Args)) {}
+  PrototypeAST(const enum CXType RetTyp, SymbolID Name,
+               ArrayRef<VarDeclAST *> Args)
+      : DeclAST(decl_prototype), RetTyp(RetTyp), Name(Name), Args(Args) {}
+  static bool classof(const DeclAST *D) {
+    return D->getKind() == decl_prototype;
+  }
 
   /**
    * @brief Get function name.
    * @return Function name.
    */
-  const std::string &getName() const { return Name; }
+  SymbolID getName() const { return Name; }
   /**
    * @brief Get return type.
    * @return Return type.
@@ -400,9 +675,9 @@ public:
    * @brief Get parameters.
    * @return Parameters.
    */
-  const std::vector<std::unique_ptr<VarDeclAST>> &getArgs() { return Args; }
+  ArrayRef<VarDeclAST *> getArgs() const { return Args; }
+  int sema() override;
   Function *codegen() override;
-  bool isVarDecl() override { return false; }
 
   /**
    * @brief Override operator `==`
@@ -429,21 +704,34 @@ class FunctionAST : public DeclAST {
   /**
    * @brief Function prototype.
    */
-  std::unique_ptr<PrototypeAST> Proto;
+  PrototypeAST *Proto;
   /**
-   * @brief Function body.
+   * @brief Function body, or nullptr if the body is unchanged since an
+   * earlier build and its IR is reused. See `incremental.h`.
    */
-  std::unique_ptr<BlockStmtAST> Body;
+  BlockStmtAST *Body;
 
 public:
   /**
    * @brief Constructor
    */
-  FunctionAST(std::unique_ptr<PrototypeAST> Proto,
-              std::unique_ptr<BlockStmtAST> Body)
-      : Proto(std::move(Proto)), Body(std::move(Body)) {}
+  FunctionAST(PrototypeAST *Proto, BlockStmtAST *Body)
+      : DeclAST(decl_function), Proto(Proto), Body(Body) {}
+  static bool classof(const DeclAST *D) {
+    return D->getKind() == decl_function;
+  }
+  /**
+   * @brief Get the function prototype.
+   * @return The prototype.
+   */
+  PrototypeAST *getProto() const { return Proto; }
+  /**
+   * @brief Get the function body.
+   * @return The body, or nullptr if it is reused.
+   */
+  BlockStmtAST *getBody() const { return Body; }
+  int sema() override;
   Function *codegen() override;
-  bool isVarDecl() override { return false; }
 };
 
 /**
@@ -453,20 +741,23 @@ class IfStmtAST : public StmtAST {
   /**
    * @brief Condition.
    */
-  std::unique_ptr<ExprAST> Cond;
+  ExprAST *Cond;
   /**
    * @brief Then statement and else statement, the latter can be nullptr.
    */
-  std::unique_ptr<StmtAST> Then, Else;
+  StmtAST *Then, *Else;
 
 public:
   /**
    * @brief Constructor.
    */
-  IfStmtAST(std::unique_ptr<ExprAST> Cond, std::unique_ptr<StmtAST> Then,
-            std::unique_ptr<StmtAST> Else)
-      : Cond(std::move(Cond)), Then(std::move(Then)), Else(std::move(Else)) {}
+  IfStmtAST(ExprAST *Cond, StmtAST *Then, StmtAST *Else)
+      : StmtAST(elem_if), Cond(Cond), Then(Then), Else(Else) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_if;
+  }
 
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -475,36 +766,47 @@ public:
  */
 class ForStmtAST : public StmtAST {
   /**
-   * @brief CX type of the loop variable. `typ_err` if has no loop variable.
+   * @brief Declaration of the loop variable, with its initial value. Can be
+   * nullptr.
    */
-  enum CXType VarType;
+  VarDeclAST *Var;
   /**
-   * @brief Loop variable name. `""` if has no loop variable.
+   * @brief Loop condition and loop step expression. Both can be nullptr.
    */
-  std::string VarName;
-  /**
-   * @brief Initial value of loop variable, loop condition, and loop step
-   * expression. All can be nullptr;
-   */
-  std::unique_ptr<ExprAST> Start, End, Step;
+  ExprAST *End, *Step;
   /**
    * @brief Loop body.
    */
-  std::unique_ptr<StmtAST> Body;
+  StmtAST *Body;
 
 public:
   /**
    * @brief Constructor.
    */
-  ForStmtAST(const enum CXType VarType, const std::string &VarName,
-             std::unique_ptr<ExprAST> Start, std::unique_ptr<ExprAST> End,
-             std::unique_ptr<ExprAST> Step, std::unique_ptr<StmtAST> Body)
-      : VarType(VarType), VarName(VarName), Start(std::move(Start)),
-        End(std::move(End)), Step(std::move(Step)), Body(std::move(Body)) {}
+  ForStmtAST(VarDeclAST *Var, ExprAST *End, ExprAST *Step, StmtAST *Body)
+      : StmtAST(elem_for), Var(Var), End(End), Step(Step), Body(Body) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_for;
+  }
 
+  int sema() override;
   Value *codegen() override;
 };
 
+/**
+ * @brief Labels of one arm of a switch and the statements they lead to.
+ */
+struct SwitchCase {
+  /**
+   * @brief Case labels. nullptr stands for `default`.
+   */
+  ArrayRef<ExprAST *> Labels;
+  /**
+   * @brief Statements of this arm.
+   */
+  ArrayRef<StmtAST *> Stmts;
+};
+
 /**
  * @brief Switch statement AST node.
  */
@@ -512,23 +814,22 @@ class SwitchStmtAST : public StmtAST {
   /**
    * @brief The expression to be switched.
    */
-  std::unique_ptr<ExprAST> Expr;
+  ExprAST *Expr;
   /**
    * @brief Labels and corresponding statements.
    */
-  std::vector<std::pair<std::vector<std::unique_ptr<ExprAST>>,
-                        std::vector<std::unique_ptr<StmtAST>>>>
-      BasicBlocks;
+  ArrayRef<SwitchCase> BasicBlocks;
 
 public:
   /**
    * @brief Constructor.
    */
-  SwitchStmtAST(std::unique_ptr<ExprAST> Expr,
-                std::vector<std::pair<std::vector<std::unique_ptr<ExprAST>>,
-                                      std::vector<std::unique_ptr<StmtAST>>>>
-                    BasicBlocks)
-      : Expr(std::move(Expr)), BasicBlocks(std::move(BasicBlocks)) {}
+  SwitchStmtAST(ExprAST *Expr, ArrayRef<SwitchCase> BasicBlocks)
+      : StmtAST(elem_switch), Expr(Expr), BasicBlocks(BasicBlocks) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_switch;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -539,18 +840,22 @@ class WhileStmtAST : public StmtAST {
   /**
    * @brief Loop condition.
    */
-  std::unique_ptr<ExprAST> Cond;
+  ExprAST *Cond;
   /**
    * @brief Loop body.
    */
-  std::unique_ptr<StmtAST> Body;
+  StmtAST *Body;
 
 public:
   /**
    * @brief Constructor.
    */
-  WhileStmtAST(std::unique_ptr<ExprAST> Cond, std::unique_ptr<StmtAST> Body)
-      : Cond(std::move(Cond)), Body(std::move(Body)) {}
+  WhileStmtAST(ExprAST *Cond, StmtAST *Body)
+      : StmtAST(elem_while), Cond(Cond), Body(Body) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_while;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -561,18 +866,22 @@ class DoStmtAST : public StmtAST {
   /**
    * @brief Loop body.
    */
-  std::unique_ptr<StmtAST> Body;
+  StmtAST *Body;
   /**
    * @brief Loop condition.
    */
-  std::unique_ptr<ExprAST> Cond;
+  ExprAST *Cond;
 
 public:
   /**
    * @brief Constructor.
    */
-  DoStmtAST(std::unique_ptr<StmtAST> Body, std::unique_ptr<ExprAST> Cond)
-      : Body(std::move(Body)), Cond(std::move(Cond)) {}
+  DoStmtAST(StmtAST *Body, ExprAST *Cond)
+      : StmtAST(elem_do), Body(Body), Cond(Cond) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_do;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -583,18 +892,22 @@ class UntilStmtAST : public StmtAST {
   /**
    * @brief Loop body.
    */
-  std::unique_ptr<StmtAST> Body;
+  StmtAST *Body;
   /**
    * @brief End condition.
    */
-  std::unique_ptr<ExprAST> Cond;
+  ExprAST *Cond;
 
 public:
   /**
    * @brief Constructor.
    */
-  UntilStmtAST(std::unique_ptr<StmtAST> Body, std::unique_ptr<ExprAST> Cond)
-      : Body(std::move(Body)), Cond(std::move(Cond)) {}
+  UntilStmtAST(StmtAST *Body, ExprAST *Cond)
+      : StmtAST(elem_until), Body(Body), Cond(Cond) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_until;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -605,13 +918,17 @@ class ReadStmtAST : public StmtAST {
   /**
    * @brief Variable to be read to.
    */
-  std::unique_ptr<ExprAST> Var;
+  ExprAST *Var;
 
 public:
   /**
    * @brief Constructor.
    */
-  ReadStmtAST(std::unique_ptr<ExprAST> Var) : Var(std::move(Var)) {}
+  ReadStmtAST(ExprAST *Var) : StmtAST(elem_read), Var(Var) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_read;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -622,13 +939,17 @@ class WriteStmtAST : public StmtAST {
   /**
    * @brief Expression to be written.
    */
-  std::unique_ptr<ExprAST> Val;
+  ExprAST *Val;
 
 public:
   /**
    * @brief Constructor.
    */
-  WriteStmtAST(std::unique_ptr<ExprAST> Val) : Val(std::move(Val)) {}
+  WriteStmtAST(ExprAST *Val) : StmtAST(elem_write), Val(Val) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_write;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -637,6 +958,14 @@ public:
  */
 class ContStmtAST : public StmtAST {
 public:
+  /**
+   * @brief Constructor.
+   */
+  ContStmtAST() : StmtAST(elem_cont) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_cont;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -645,6 +974,14 @@ public:
  */
 class BrkStmtAST : public StmtAST {
 public:
+  /**
+   * @brief Constructor.
+   */
+  BrkStmtAST() : StmtAST(elem_brk) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_brk;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -655,13 +992,17 @@ class RetStmtAST : public StmtAST {
   /**
    * @brief The expression to be returned.
    */
-  std::unique_ptr<ExprAST> Val;
+  ExprAST *Val;
 
 public:
   /**
    * @brief Constructor.
    */
-  RetStmtAST(std::unique_ptr<ExprAST> Val) : Val(std::move(Val)) {}
+  RetStmtAST(ExprAST *Val) : StmtAST(elem_ret), Val(Val) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_ret;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
@@ -678,14 +1019,23 @@ class CastExprAST : public ExprAST {
   /**
    * @brief Expression to be cast.
    */
-  std::unique_ptr<ExprAST> From;
+  ExprAST *From;
 
 public:
   /**
    * @brief Constructor.
    */
-  CastExprAST(const enum CXType Type, std::unique_ptr<ExprAST> From)
-      : Type(Type), From(std::move(From)) {}
+  CastExprAST(const enum CXType Type, ExprAST *From)
+      : ExprAST(expr_cast), Type(Type), From(From) {}
+  static bool classof(const ExprAST *E) {
+    return E->getKind() == expr_cast;
+  }
+  /**
+   * @brief Get the expression to be cast.
+   * @return The expression.
+   */
+  ExprAST *getFrom() const { return From; }
+  enum CXType sema() override;
   Value *codegen() override;
 };
 
@@ -696,14 +1046,17 @@ class ExitStmtAST : public StmtAST {
   /**
    * @brief Exit code.
    */
-  std::unique_ptr<ExprAST> ExitCode;
+  ExprAST *ExitCode;
 
 public:
   /**
    * @brief Constructor.
    */
-  ExitStmtAST(std::unique_ptr<ExprAST> ExitCode)
-      : ExitCode(std::move(ExitCode)) {}
+  ExitStmtAST(ExprAST *ExitCode) : StmtAST(elem_exit), ExitCode(ExitCode) {}
+  static bool classof(const BlockElemAST *E) {
+    return E->getKind() == elem_exit;
+  }
+  int sema() override;
   Value *codegen() override;
 };
 
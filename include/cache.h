@@ -0,0 +1,75 @@
+#pragma once
+
+#include "emit.h"
+#include <cstdint>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <string>
+
+using namespace llvm;
+
+/**
+ * @brief Where and how compiled output is cached.
+ */
+struct CacheOptions {
+  /**
+   * @brief Cache directory. Empty if caching is off.
+   */
+  std::string Dir;
+  /**
+   * @brief Size the directory is pruned to, by evicting the least recently
+   * used outputs.
+   */
+  uint64_t MaxBytes = uint64_t(512) << 20;
+  /**
+   * @brief Whether to print a line to stderr on every hit and miss.
+   */
+  bool Report = false;
+};
+
+/**
+ * Hash a token just returned by `gettok()`, along with its spelling or value.
+ * @param Hasher The hash to update, either an `MD5` or a `SHA256`.
+ * @param Tok The token.
+ */
+template <typename HasherT> void HashToken(HasherT &Hasher, int Tok);
+
+/**
+ * Compute the key that identifies a compilation in the cache. It hashes the
+ * tokens of the sources rather than their text, so that changes to
+ * whitespace and comments still hit, together with the flags, the host and
+ * the compiler itself.
+ * @param Files The sources. A single one must already be loaded by
+ * `OpenSource()`, and is rewound once hashed. Several ones are loaded here,
+ * one after another.
+ * @param Flags Every flag that changes the output, in any fixed form.
+ * @return The key, or `""` if the sources cannot be hashed.
+ */
+std::string GetCacheKey(ArrayRef<std::string> Files, StringRef Flags);
+
+/**
+ * Look up an output in the cache, and on a hit copy it to its destination
+ * and mark it as recently used.
+ * @param Opts Cache options.
+ * @param Key Key from `GetCacheKey()`.
+ * @param OutFile Output file name. `"-"` stands for stdout.
+ * @return True on a hit; false on a miss, after which the output is to be
+ * compiled and passed to `EmitModuleCached()`.
+ */
+bool FetchCachedOutput(const CacheOptions &Opts, StringRef Key,
+                       const std::string &OutFile);
+
+/**
+ * Like `EmitModule()`, but store the output in the cache first and copy it
+ * from there. The entry is written to a temporary file and renamed into
+ * place, so concurrent compilers never see half of it. The cache is then
+ * pruned to its size limit. If the cache cannot be written, the output is
+ * emitted as if there were no cache.
+ * @param Opts Cache options.
+ * @param Key Key from `GetCacheKey()`.
+ * @return 0 if nothing goes wrong; 1 otherwise.
+ */
+int EmitModuleCached(const CacheOptions &Opts, StringRef Key, Module &M,
+                     TargetMachine *TM, enum EmitKind Kind,
+                     const std::string &OutFile,
+                     const BitcodeOptions &BCOpts);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * Runtime library of CX programs. Generated code calls these functions
+ * instead of the C standard I/O functions. Output is buffered, and input is
+ * read from stdin in large blocks, or mapped if stdin is a regular file.
+ * They are linked into executables from `libcxrt.a`, into the compiler
+ * itself for `--run`, and can be loaded into `lli` from `libcxrt.so`.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Write an integer and a newline to stdout. Like the rest of CX, it prints
+ * the value as unsigned, as `printf("%u\n")` would.
+ * @param V The integer.
+ */
+void cx_write_i32(int32_t V);
+
+/**
+ * Write a double and a newline to stdout, in the same form as
+ * `printf("%f\n")`.
+ * @param V The double.
+ */
+void cx_write_f64(double V);
+
+/**
+ * Write everything buffered so far to stdout. It runs by itself when the
+ * buffer fills and when the program exits.
+ */
+void cx_flush(void);
+
+/**
+ * Read an integer from stdin, skipping whitespace before it. Like
+ * `scanf("%u")`, it accepts an optional sign and keeps the value modulo 2^32.
+ * @return The integer, or 0 if there is no integer to read.
+ */
+int32_t cx_read_i32(void);
+
+/**
+ * Read a double from stdin, skipping whitespace before it. It accepts what
+ * `strtod()` does.
+ * @return The double, or 0 if there is no double to read.
+ */
+double cx_read_f64(void);
+
+/**
+ * Read an integer from stdin as `cx_read_i32()` does and see if it is
+ * nonzero.
+ * @return True if it is and false otherwise.
+ */
+bool cx_read_bool(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "cache.h"
+#include "emit.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief What the command line asks the compiler to do.
+ */
+struct DriverOptions {
+  /**
+   * @brief Optimization level, from 0 to 3.
+   */
+  unsigned OptLevel = 0;
+  /**
+   * @brief Custom pass pipeline run instead of the one of OptLevel, if not
+   * empty.
+   */
+  std::string Pipeline;
+  /**
+   * @brief Whether to print the time spent in each pass.
+   */
+  bool TimePasses = false;
+  /**
+   * @brief Whether to print the time spent in each phase, pass and function.
+   */
+  bool TimeReport = false;
+  /**
+   * @brief Whether to print that report as JSON instead of a table.
+   */
+  bool TimeReportJSON = false;
+  /**
+   * @brief Whether to print the memory taken by the AST, the symbol tables,
+   * the IR of each function, and each phase.
+   */
+  bool MemReport = false;
+  /**
+   * @brief Whether to print that report as JSON instead of a table.
+   */
+  bool MemReportJSON = false;
+  /**
+   * @brief Whether to JIT-compile the program and run it instead of emitting
+   * it.
+   */
+  bool Run = false;
+  /**
+   * @brief Whether to rebuild the source whenever it changes.
+   */
+  bool Watch = false;
+  /**
+   * @brief Whether to only check the program for errors.
+   */
+  bool SyntaxOnly = false;
+  /**
+   * @brief Number of threads that generate IR or compile files, or 0.
+   */
+  unsigned Threads = 0;
+  /**
+   * @brief What to emit.
+   */
+  enum EmitKind Kind = emit_llvm;
+  /**
+   * @brief Output file name. `"-"` stands for stdout.
+   */
+  std::string OutFile;
+  /**
+   * @brief Options for bitcode output.
+   */
+  BitcodeOptions BCOpts;
+  /**
+   * @brief Target CPU.
+   */
+  std::string CPU = "native";
+  /**
+   * @brief Output cache options.
+   */
+  CacheOptions Cache;
+  /**
+   * @brief Source files. No file stands for stdin.
+   */
+  std::vector<std::string> InputFiles;
+  /**
+   * @brief Whether only the usage is asked for, which has been printed.
+   */
+  bool Help = false;
+  /**
+   * @brief Whether to serve compilations on a socket instead. See
+   * `server.h`.
+   */
+  bool Server = false;
+  /**
+   * @brief Path of the socket to serve on.
+   */
+  std::string Socket;
+};
+
+/**
+ * Parse the command line, and work out the output file if it is not given.
+ * Errors are printed along with the usage.
+ * @param Opts Where the options go.
+ * @return 0 if nothing goes wrong; 1 otherwise.
+ */
+int ParseDriverArgs(int argc, char **argv, DriverOptions &Opts);
+
+/**
+ * Compile, and emit or run, the program as the options ask. This is all
+ * that the compiler does, apart from serving other compilations.
+ * @param Opts Options from `ParseDriverArgs()`.
+ * @return The exit status of the compiler, or of the program if it is run.
+ */
+int RunDriver(const DriverOptions &Opts);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Target/TargetMachine.h>
+#include <memory>
+#include <string>
+
+using namespace llvm;
+
+/**
+ * @brief Kinds of output the driver can produce.
+ */
+enum EmitKind { emit_llvm = 0, emit_bc, emit_asm, emit_obj, emit_exe };
+
+/**
+ * Map a driver optimization level to the code generator's.
+ * @param OptLevel Optimization level, from 0 to 3.
+ * @return The corresponding code generation optimization level.
+ */
+CodeGenOpt::Level getCodeGenOptLevel(unsigned OptLevel);
+
+/**
+ * Create a target machine for the host triple, and set the module's target
+ * triple and data layout accordingly, so that the optimizer and the backend
+ * agree on them.
+ * @param M The module to be compiled.
+ * @param CPU Target CPU. `""` or `"native"` selects the host CPU along with
+ * its features.
+ * @param OptLevel Optimization level, from 0 to 3.
+ * @return The target machine, or nullptr if the host is not supported.
+ */
+std::unique_ptr<TargetMachine>
+InitializeTarget(Module &M, const std::string &CPU, unsigned OptLevel);
+
+/**
+ * @brief Options for bitcode output.
+ */
+struct BitcodeOptions {
+  /**
+   * @brief Whether to record a hash of the module in the bitcode.
+   */
+  bool ModuleHash = false;
+  /**
+   * @brief Whether to write a symbol table, so that linkers can read the
+   * module's symbols without parsing it.
+   */
+  bool Symtab = false;
+};
+
+/**
+ * Write the module to a file in the given form. Executables are linked by
+ * the system C compiler driver, which is `$CC` or `cc`, against the runtime
+ * library `libcxrt.a` next to the compiler.
+ * @param M The module to be emitted.
+ * @param TM Target machine from `InitializeTarget()`. Only used for native
+ * output.
+ * @param Kind What to emit.
+ * @param OutFile Output file name. `"-"` stands for stdout.
+ * @param BCOpts Options for bitcode output.
+ * @return 0 if nothing goes wrong; 1 otherwise.
+ */
+int EmitModule(Module &M, TargetMachine *TM, enum EmitKind Kind,
+               const std::string &OutFile,
+               const BitcodeOptions &BCOpts = BitcodeOptions());
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "AST.h"
+#include <llvm/ADT/STLExtras.h>
+#include <memory>
+#include <string>
+
+using namespace llvm;
+
+// A watched source is rebuilt in the same process every time it changes.
+// Every function definition has a fingerprint: a hash of its prototype and
+// body tokens, and of the signatures of the globals and functions it refers
+// to. A definition whose fingerprint is unchanged is not parsed, checked or
+// generated again; its IR is moved over from the previous build instead.
+// Optimization and emission are not incremental: they run on the whole
+// module every time, and take most of a rebuild of a big file.
+
+/**
+ * Build a source file, and build it again whenever it changes, until the
+ * process is killed. A build that fails leaves the previous one to be reused
+ * by the next.
+ * @param File Name of the source file.
+ * @param Threads Number of threads that generate the IR of changed
+ * functions, or 0 for as many as there are hardware threads.
+ * @param Emit Optimize and emit TheModule once it is built.
+ * @param InPlace Emit leaves TheModule as it is, so that the next build may
+ * take functions from it without keeping a copy.
+ * @return 1 if the file cannot be watched. It does not return otherwise.
+ */
+int WatchSource(const std::string &File, unsigned Threads,
+                function_ref<int()> Emit, bool InPlace);
+
+/**
+ * See if the build on this thread may reuse function bodies.
+ * @return True if yes and false if no.
+ */
+bool isIncrementalBuild();
+/**
+ * Fingerprint a function body about to be parsed. If the fingerprint is the
+ * same as in the previous build, skip the body.
+ * @param Proto The prototype of the function. The current token is the `{`
+ * of its body.
+ * @return True if the body is skipped, with the current token after its
+ * `}`; false if it is to be parsed, with the current token still its `{`.
+ */
+bool SkipUnchangedBody(PrototypeAST *Proto);
+/**
+ * Take a function definition of an incremental build after it passes
+ * semantic analysis. A skipped body is moved over from the previous build
+ * once parsing is done; any other one is queued with `QueueFunction()`.
+ * @param F The definition.
+ * @param Nodes The arena holding the nodes of F.
+ * @return 0 if nothing goes wrong; 1 otherwise.
+ */
+int AddIncrementalFunction(FunctionAST *F, std::unique_ptr<ASTArena> Nodes);
@@ -1,36 +1,54 @@
 #pragma once
 
 #include "AST.h"
+#include "symbol.h"
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/IRBuilder.h>
 #include <map>
 
 using namespace llvm;
 
+// Each thread generates code into its own context and module, so all of the
+// state below is per thread.
+
 /**
  * @brief The LLVM Context.
  */
-extern std::unique_ptr<LLVMContext> TheContext;
+extern thread_local std::unique_ptr<LLVMContext> TheContext;
 /**
  * @brief The LLVM Module.
  */
-extern std::unique_ptr<Module> TheModule;
+extern thread_local std::unique_ptr<Module> TheModule;
 /**
  * @brief An LLVM IR Builder.
  */
-extern std::unique_ptr<IRBuilder<>> Builder;
+extern thread_local std::unique_ptr<IRBuilder<>> Builder;
+/**
+ * Local variables of the function being generated, by the declarations that
+ * semantic analysis bound their uses to, and their addresses.
+ */
+extern thread_local DenseMap<const VarDeclAST *, AllocaInst *> LocalValues;
 /**
- * Local variable names, if they are constant and their addresses.
+ * Global variable names and their LLVM globals.
  */
-extern std::map<std::string, std::pair<bool, AllocaInst *>> NamedValues;
+extern thread_local DenseMap<SymbolID, GlobalVariable *> NamedGlobals;
 /**
- * Function names and their prototypes.
+ * Function names and their LLVM functions.
  */
-extern std::map<std::string, std::unique_ptr<PrototypeAST>> NamedFns;
+extern thread_local DenseMap<SymbolID, Function *> NamedFunctions;
 
 /**
  * Initialize the LLVM Module, including creating essential instances and
- * declaring `scanf`, `printf` and `exit` functions, as well as creating
- * variables that will be used as parameters in those functions.
+ * declaring `exit` along with the input and output functions of the runtime
+ * library.
  */
 void InitializeModule();
+/**
+ * Start a module that holds only part of the program, to be linked into the
+ * module of `InitializeModule()` later. The context of the calling thread is
+ * created on first use and kept for its later parts. Globals and functions
+ * are declared in the part as they are used.
+ */
+void InitializePartModule();
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <memory>
+
+using namespace llvm;
+
+/**
+ * Compile the module in process with ORC's LLJIT and call its `main`.
+ * External functions such as `exit` and those of the runtime library
+ * are resolved against the host process, which has the runtime linked in, so
+ * an `exit` in the program ends the compiler with the same exit code.
+ * @param M The module to be run. The JIT takes ownership of it.
+ * @param Ctx The context owning the module.
+ * @param OptLevel Optimization level of the JIT's code generator, from 0 to 3.
+ * @param Ret Set to the value returned by `main`.
+ * @return 0 if nothing goes wrong; 1 otherwise.
+ */
+int RunModule(std::unique_ptr<Module> M, std::unique_ptr<LLVMContext> Ctx,
+              unsigned OptLevel, int &Ret);
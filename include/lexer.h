@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <llvm/ADT/StringRef.h>
 #include <string>
 
 /**
@@ -55,21 +58,77 @@ enum Token {
   tok_const = -36,
 };
 
+// Every thread has a lexer of its own, so that several sources can be
+// compiled at once.
+
+/**
+ * Spelling of the current token if it is an identifier. It points into the
+ * source buffer and stays valid until the next `OpenSource()`.
+ */
+extern thread_local llvm::StringRef IdentifierStr;
 /**
- * String form of the current token.
+ * Value of the current token if it is a double literal.
  */
-extern std::string IdentifierStr;
+extern thread_local double NumVal;
 /**
- * Value of the current token if it is a literal.
+ * Value of the current token if it is an integer literal, modulo 2^64.
  */
-extern double NumVal;
+extern thread_local uint64_t IntVal;
 /**
  * Current line number.
  */
-extern unsigned NR;
+extern thread_local unsigned NR;
+/**
+ * Byte offset of the first character of the current token in the source.
+ */
+extern thread_local size_t TokOffset;
+/**
+ * Length in bytes of the current token.
+ */
+extern thread_local size_t TokLength;
+
+/**
+ * Load the whole source file into memory, and reset the lexer to its start.
+ * Regular files are mapped when possible; pipes and terminals are read in
+ * chunks until EOF.
+ * @param FileName Source file name. `"-"` stands for stdin.
+ * @return 0 if nothing goes wrong; 1 otherwise.
+ */
+int OpenSource(const std::string &FileName);
+/**
+ * Reset the lexer to the start of the source loaded by `OpenSource()`, so
+ * that it can be scanned again, even if it came from stdin.
+ */
+void RewindSource();
+
+/**
+ * @brief Where a token starts in the source.
+ */
+struct SourcePosition {
+  /**
+   * @brief Byte offset of its first character.
+   */
+  size_t Offset;
+  /**
+   * @brief Its line number.
+   */
+  unsigned Line;
+};
+
+/**
+ * Get where the current token starts.
+ * @return Its position.
+ */
+SourcePosition getTokenPosition();
+/**
+ * Move the lexer back to a token it has returned before, so that the next
+ * `gettok()` returns that token again.
+ * @param Pos Position from `getTokenPosition()`, in the same source.
+ */
+void SeekSource(SourcePosition Pos);
 
 /**
- * Get a new token from input stream.
+ * Get a new token from the source loaded by `OpenSource()`.
  * @return The token it gets.
  */
 int gettok();
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/IR/Function.h>
+#include <llvm/Support/TypeName.h>
+
+using namespace llvm;
+
+/**
+ * Whether memory use is being recorded. It is set once before compiling
+ * starts, and counting costs a branch and nothing else while it is false.
+ */
+extern bool MemReportEnabled;
+
+/**
+ * Give a class of AST nodes an index for `CountASTNode()`.
+ * @param Name Name of the class.
+ * @return Its index, the same every time for the same name.
+ */
+unsigned RegisterASTClass(StringRef Name);
+
+/**
+ * Get the index of a class of AST nodes, registering it on first use.
+ * @return Its index.
+ */
+template <typename T> unsigned getASTClassID() {
+  static const unsigned ID = RegisterASTClass(getTypeName<T>());
+  return ID;
+}
+
+/**
+ * Get the index that child lists of AST nodes are counted under.
+ * @return Its index.
+ */
+unsigned getASTListID();
+
+/**
+ * Count an allocation in the AST arena of the calling thread.
+ * @param ClassID Index of the class of the node, or of child lists.
+ * @param Bytes Size of the allocation.
+ */
+void CountASTNode(unsigned ClassID, size_t Bytes);
+
+/**
+ * Charge the AST nodes the calling thread has allocated since its last call
+ * to a top-level declaration, along with the growth of the peak resident set
+ * since then, and take the size of the symbol tables of the thread.
+ * @param Function Name of the function declared, or `""` if the memory does
+ * not belong to a function.
+ * @param ArenaBytes Bytes the arena of the declaration handed out.
+ */
+void RecordDeclarationMemory(StringRef Function, size_t ArenaBytes);
+
+/**
+ * Record the number of basic blocks and instructions of a function.
+ * @param F The function, defined.
+ * @param Optimized Whether it has been optimized, or has just been
+ * generated.
+ */
+void RecordFunctionIR(const Function &F, bool Optimized);
+
+/**
+ * Take the peak resident set of the compiler at the end of a phase.
+ * @param Phase Name of the phase.
+ */
+void RecordPhaseMemory(StringRef Phase);
+
+/**
+ * Print what has been recorded to stderr: the peak resident set after each
+ * phase, AST nodes by class, symbol table sizes, and the functions that
+ * take the most memory.
+ * @param JSON Print JSON instead of a table, with every function.
+ */
+void PrintMemReport(bool JSON);
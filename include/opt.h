@@ -0,0 +1,22 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+#include <string>
+
+using namespace llvm;
+
+/**
+ * Run LLVM's new pass manager over the module.
+ * @param M The module to be optimized.
+ * @param TM Target machine whose cost model guides the optimizer. Can be
+ * nullptr.
+ * @param OptLevel Optimization level, from 0 to 3, selecting the default
+ * per-module pipeline of the corresponding `-O` level.
+ * @param Pipeline A textual pass pipeline in the syntax of `opt -passes=`. If
+ * it is not empty, it replaces the default pipeline of `OptLevel`.
+ * @param TimePasses Whether to print the time spent in each pass to stderr.
+ * @return 0 if nothing goes wrong; 1 otherwise.
+ */
+int OptimizeModule(Module &M, TargetMachine *TM, unsigned OptLevel,
+                   const std::string &Pipeline, bool TimePasses);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "AST.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Module.h>
+#include <memory>
+#include <string>
+
+/**
+ * Start generating the IR of function definitions on worker threads. Until
+ * `FinishParallelCodegen()`, definitions go through `QueueFunction()` instead
+ * of being generated in place.
+ * @param Threads Number of worker threads.
+ */
+void StartParallelCodegen(unsigned Threads);
+/**
+ * Declare a function definition in TheModule and queue its body for a worker,
+ * which generates it into a part module of its own.
+ * @param F The definition, which has passed semantic analysis.
+ * @param Nodes The arena holding the nodes of F, freed once its IR exists.
+ * @return 0 if nothing goes wrong; 1 otherwise.
+ */
+int QueueFunction(FunctionAST *F, std::unique_ptr<ASTArena> Nodes);
+/**
+ * Wait for the workers and move the functions of the parts into TheModule.
+ * Functions keep the place they were first declared in, so the module is the
+ * same as if it had been generated in place, for any number of threads.
+ * @return 0 if nothing goes wrong; 1 otherwise.
+ */
+int FinishParallelCodegen();
+/**
+ * Move function definitions from another module in the context of TheModule
+ * into TheModule, each in place of its declaration there, and make them use
+ * the globals and functions of TheModule instead of those of the other
+ * module. It takes time in the size of the other module only.
+ * @param From The module the definitions are in.
+ * @param Functions The definitions. TheModule declares them with the same
+ * types, and everything they use.
+ */
+void MoveFunctions(Module &From, ArrayRef<Function *> Functions);
+/**
+ * Compile several translation units at once, each on a thread of its own
+ * with its own parser, symbol tables and module, and link them into
+ * TheModule in the order they are given. A unit calls the functions of
+ * another one through their prototypes.
+ * @param Files Names of the source files, `"-"` standing for stdin.
+ * @param Threads Number of units compiled at once, or 0 for as many as there
+ * are hardware threads.
+ * @param SyntaxOnly Only check the units, so that TheModule need not exist.
+ * @return 0 if nothing goes wrong; 1 otherwise.
+ */
+int CompileUnits(ArrayRef<std::string> Files, unsigned Threads,
+                 bool SyntaxOnly);
@@ -1,14 +1,13 @@
 #pragma once
 
 #include "AST.h"
-#include <map>
 #include <memory>
 
 /**
- * Precedence of binary operators. Every key in this map is recognized as a
- * binary operator.
+ * Name of the translation unit shown in front of the line number of errors,
+ * or nullptr if only one unit is compiled. It is per thread, like the parser.
  */
-extern std::map<int, int> BinopPrecedence;
+extern thread_local const char *UnitName;
 
 /**
  * Get a new token from input stream and replace current token with it.
@@ -17,11 +16,18 @@ extern std::map<int, int> BinopPrecedence;
 int getNextToken();
 /**
  * Keep getting new tokens and do parsing procedures accordingly, until EOF.
+ * Every top-level declaration is checked by semantic analysis and then
+ * compiled into the module. Each call starts a new translation unit, with no
+ * declarations from the previous one.
+ * @param SyntaxOnly Stop after semantic analysis, so that no IR is generated
+ * and the module need not exist.
+ * @param Threads Number of threads that generate the IR of function
+ * definitions while parsing goes on, or 0 to generate it in place.
  * @return 0 if nothing goes wrong; 1 otherwise.
  */
-int MainLoop();
+int MainLoop(bool SyntaxOnly, unsigned Threads);
 /**
  * Print errors occurring when parsing expressions.
  * @return nullptr
  */
-std::unique_ptr<ExprAST> LogError(const char *Str);
+ExprAST *LogError(const char *Str);
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "symbol.h"
+#include <algorithm>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+
+using namespace llvm;
+
+/**
+ * Symbol table of nested scopes. Every name maps to its innermost binding.
+ * Entering a scope costs O(1). Leaving one only undoes the bindings made in
+ * it, so scopes are never copied.
+ */
+template <typename ValueT> class ScopedSymbolTable {
+  /**
+   * @brief A bound value and the depth of the scope it was bound in.
+   */
+  struct Binding {
+    ValueT Value;
+    unsigned Depth;
+  };
+  /**
+   * @brief A name bound in an open scope and the binding it shadowed, if any.
+   */
+  struct UndoEntry {
+    SymbolID Name;
+    bool Shadows;
+    Binding Old;
+  };
+
+  /**
+   * @brief Innermost binding of every visible name.
+   */
+  DenseMap<SymbolID, Binding> Bindings;
+  /**
+   * @brief Bindings made in open scopes, innermost last.
+   */
+  SmallVector<UndoEntry, 32> Undo;
+  /**
+   * @brief Size of `Undo` on entry to each open scope.
+   */
+  SmallVector<unsigned, 16> Scopes;
+  /**
+   * @brief Most bindings open at once since the last `clear()`.
+   */
+  size_t Peak = 0;
+
+public:
+  /**
+   * @brief Open a new innermost scope.
+   */
+  void pushScope() { Scopes.push_back(Undo.size()); }
+  /**
+   * @brief Close the innermost scope, making the names it shadowed visible
+   * again.
+   */
+  void popScope() {
+    unsigned Mark = Scopes.pop_back_val();
+    while (Undo.size() > Mark) {
+      UndoEntry E = Undo.pop_back_val();
+      if (E.Shadows)
+        Bindings[E.Name] = E.Old;
+      else
+        Bindings.erase(E.Name);
+    }
+  }
+  /**
+   * @brief Bind a name in the innermost scope.
+   * @param Name The name.
+   * @param Value Value to bind it to.
+   */
+  void insert(SymbolID Name, ValueT Value) {
+    Binding New = {Value, (unsigned)Scopes.size()};
+    auto Inserted = Bindings.try_emplace(Name, New);
+    if (Inserted.second) {
+      Undo.push_back({Name, false, Binding()});
+    } else {
+      Undo.push_back({Name, true, Inserted.first->second});
+      Inserted.first->second = New;
+    }
+    Peak = std::max<size_t>(Peak, Undo.size());
+  }
+  /**
+   * @brief Look a name up without binding it.
+   * @param Name The name.
+   * @return Its innermost value, or a value-initialized `ValueT` if it is not
+   * bound.
+   */
+  ValueT lookup(SymbolID Name) const {
+    auto It = Bindings.find(Name);
+    return It == Bindings.end() ? ValueT() : It->second.Value;
+  }
+  /**
+   * @brief See if a name is bound in the innermost scope itself.
+   * @param Name The name.
+   * @return True if yes and false if no.
+   */
+  bool isBoundInScope(SymbolID Name) const {
+    auto It = Bindings.find(Name);
+    return It != Bindings.end() && It->second.Depth == Scopes.size();
+  }
+  /**
+   * @brief Get the most bindings that were open at once since the last
+   * `clear()`.
+   * @return Number of bindings, shadowed ones included.
+   */
+  size_t getPeakSize() const { return Peak; }
+  /**
+   * @brief Get the memory the table holds on to.
+   * @return Number of bytes.
+   */
+  size_t getMemorySize() const {
+    return Bindings.getMemorySize() + Undo.capacity_in_bytes() +
+           Scopes.capacity_in_bytes();
+  }
+  /**
+   * @brief Drop every scope and binding.
+   */
+  void clear() {
+    Bindings.clear();
+    Undo.clear();
+    Scopes.clear();
+    Peak = 0;
+  }
+};
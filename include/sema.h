@@ -0,0 +1,56 @@
+#pragma once
+
+#include "AST.h"
+#include "scope.h"
+#include "symbol.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/SmallVector.h>
+
+using namespace llvm;
+
+/**
+ * @brief What semantic analysis knows about a global variable.
+ */
+struct GlobalVarInfo {
+  /**
+   * @brief CX type of the variable.
+   */
+  enum CXType Type;
+  /**
+   * @brief Whether it is a constant variable.
+   */
+  bool isConst;
+};
+
+// Every thread checks a translation unit of its own, so the tables are per
+// thread.
+
+/**
+ * Local variable names and their declarations, scoped by block.
+ */
+extern thread_local ScopedSymbolTable<VarDeclAST *> LocalDecls;
+/**
+ * Global variable names and what is known about them.
+ */
+extern thread_local DenseMap<SymbolID, GlobalVarInfo> GlobalDecls;
+/**
+ * Function names and their prototypes.
+ */
+extern thread_local DenseMap<SymbolID, PrototypeAST *> FunctionDecls;
+/**
+ * Names of the functions that have a body.
+ */
+extern thread_local DenseSet<SymbolID> DefinedFunctions;
+
+/**
+ * If not null, the names of the global variables and functions that checked
+ * code refers to are appended here, possibly more than once.
+ */
+extern thread_local SmallVectorImpl<SymbolID> *ReferencedNames;
+
+/**
+ * Forget every declaration, before another translation unit is checked on
+ * the same thread.
+ */
+void ResetSema();
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// The compile server and its client `cxc` talk over a Unix stream socket,
+// one compilation per connection:
+//
+// 1. The client sends the length of the request as a uint32_t, then the
+//    request: its working directory and its arguments, each followed by a
+//    NUL. Its stdin, stdout and stderr go along with the first byte.
+// 2. The server compiles in a process forked for the client, which writes
+//    to the client's stdout and stderr itself.
+// 3. The server sends the exit status of that process as an int32_t, and
+//    closes the connection.
+//
+// Both ends only talk to a process of the same user, which they check with
+// SO_PEERCRED, and the socket is only accessible to that user.
+//
+// This header is shared with the client, which does not use LLVM.
+
+/**
+ * Get the directory of the default socket when there is no
+ * `$XDG_RUNTIME_DIR`. The server creates it with mode 0700.
+ * @return `/tmp/cxc-<uid>`.
+ */
+inline std::string GetPrivateSocketDir() {
+  return "/tmp/cxc-" + std::to_string(getuid());
+}
+
+/**
+ * Get the path of the socket the server listens on by default.
+ * @return `$CXC_SOCKET` if set; `$XDG_RUNTIME_DIR/cxc.sock` if that is set;
+ * `/tmp/cxc-<uid>/cxc.sock` otherwise.
+ */
+inline std::string GetServerSocketPath() {
+  if (const char *Path = getenv("CXC_SOCKET"))
+    return Path;
+  const char *RuntimeDir = getenv("XDG_RUNTIME_DIR");
+  if (RuntimeDir && *RuntimeDir)
+    return std::string(RuntimeDir) + "/cxc.sock";
+  return GetPrivateSocketDir() + "/cxc.sock";
+}
+
+/**
+ * Check that the process at the other end of a connected Unix socket runs
+ * as the same user as this one.
+ * @param FD The connected socket.
+ * @return true if it does; false if it does not or cannot be told.
+ */
+inline bool IsPeerSameUser(int FD) {
+  ucred Cred;
+  socklen_t Size = sizeof(Cred);
+  return getsockopt(FD, SOL_SOCKET, SO_PEERCRED, &Cred, &Size) == 0 &&
+         Size == sizeof(Cred) && Cred.uid == getuid();
+}
+
+/**
+ * Serve compilations on a Unix socket until the process is killed. The
+ * server sets up LLVM once, then forks a process for every client. A
+ * process starts warm from that state, and compiles as if the client's
+ * arguments had been passed to the compiler, in the client's working
+ * directory and with its standard streams. Clients are served at the same
+ * time, each process being independent of the others. The socket is
+ * created with mode 0600, and clients of other users are turned away.
+ * @param Path Path of the socket. If it is in GetPrivateSocketDir(), that
+ * directory is created, and must be owned by the user and have mode 0700.
+ * @return 1 if the socket cannot be set up. It does not return otherwise.
+ */
+int RunServer(const std::string &Path);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <llvm/ADT/StringRef.h>
+
+using namespace llvm;
+
+/**
+ * An interned identifier. Two identifiers have the same ID if and only if
+ * they are spelled the same, so names can be compared and hashed as integers.
+ * ID 0 is the empty name.
+ */
+typedef uint32_t SymbolID;
+
+/**
+ * Get the ID of a name, interning it on first sight. It may be called from
+ * several threads at once, which share the IDs.
+ * @param Name The name. It is copied, so it need not outlive the call.
+ * @return Its ID.
+ */
+SymbolID internSymbol(StringRef Name);
+
+/**
+ * Get the spelling of an interned name.
+ * @param ID ID returned by `internSymbol()`.
+ * @return Its spelling, which stays valid until the program exits.
+ * @note It may be called from any thread that was handed the ID, also while
+ * other threads intern names.
+ */
+StringRef getSymbolName(SymbolID ID);
+
+/**
+ * Get the number of names interned so far.
+ * @return Number of IDs in use.
+ */
+size_t getNumSymbols();
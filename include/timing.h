@@ -0,0 +1,81 @@
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+
+using namespace llvm;
+
+/**
+ * @brief Phases of a compilation that `-ftime-report` tells apart.
+ */
+enum TimePhase {
+  time_lex = 0,
+  time_parse,
+  time_sema,
+  time_irgen,
+  time_verify,
+  time_opt,
+  time_emit,
+};
+
+/**
+ * Number of phases in `TimePhase`.
+ */
+constexpr unsigned NumTimePhases = time_emit + 1;
+
+/**
+ * Whether compile times are being recorded. It is set once before compiling
+ * starts, and scopes cost a branch and nothing else while it is false.
+ */
+extern bool TimeReportEnabled;
+
+/**
+ * Charge the calling thread's time to a phase until the end of the scope,
+ * then go back to the phase before it. Time spent in a nested scope is only
+ * charged to the nested phase, and time outside of every scope is not
+ * charged at all.
+ */
+class TimeScope {
+  bool Active;
+
+public:
+  /**
+   * @brief Constructor.
+   * @param Phase Phase the time goes to.
+   */
+  explicit TimeScope(enum TimePhase Phase);
+  /**
+   * @brief Destructor.
+   */
+  ~TimeScope();
+  TimeScope(const TimeScope &) = delete;
+  TimeScope &operator=(const TimeScope &) = delete;
+};
+
+/**
+ * Charge the time the calling thread has spent in each phase since its last
+ * call to a top-level declaration. Phases are per thread until then, so that
+ * threads only synchronize once per declaration.
+ * @param Function Name of the function declared, or `""` if the time does
+ * not belong to a function.
+ */
+void RecordDeclarationTimes(StringRef Function);
+
+/**
+ * Record the time a run of an optimization pass or analysis takes, not
+ * counting the passes and analyses it runs itself.
+ * @param Pass Name of the pass or analysis.
+ * @param isAnalysis Whether it is an analysis.
+ * @param Function Function it runs on, or `""` for larger units.
+ * @param Seconds Time it takes.
+ */
+void RecordPassTime(StringRef Pass, bool isAnalysis, StringRef Function,
+                    double Seconds);
+
+/**
+ * Print what has been recorded to stderr, with every phase, every pass and
+ * the slowest functions. Phases are summed over threads, so with `-j` they
+ * can add up to more than the wall time.
+ * @param JSON Print JSON instead of a table, with every function.
+ * @param WallSeconds Wall time of the whole compilation.
+ */
+void PrintTimeReport(bool JSON, double WallSeconds);
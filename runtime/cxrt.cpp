@@ -0,0 +1,150 @@
+#include "cxrt.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace {
+
+/// Output that has not reached file descriptor 1 yet.
+char OutBuf[1 << 16];
+size_t OutLen = 0;
+
+/// The longest line `formatF64()` produces: a sign, 20 integer digits, the
+/// point, 6 decimals and the newline.
+constexpr size_t MaxF64Line = 1 + 20 + 1 + 6 + 1;
+
+void writeAll(const char *P, size_t N) {
+  while (N) {
+    ssize_t W = write(1, P, N);
+    if (W < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    P += W;
+    N -= W;
+  }
+}
+
+/// Make room for N more bytes and return where they go.
+char *reserve(size_t N) {
+  if (OutLen + N > sizeof(OutBuf))
+    cx_flush();
+  return OutBuf + OutLen;
+}
+
+char *formatU64(char *P, uint64_t V) {
+  char Tmp[20];
+  char *T = Tmp + sizeof(Tmp);
+  do {
+    *--T = '0' + V % 10;
+    V /= 10;
+  } while (V);
+  size_t N = Tmp + sizeof(Tmp) - T;
+  memcpy(P, T, N);
+  return P + N;
+}
+
+/// Format V like `%f`, rounding its exact binary value to 6 decimals, half to
+/// even, as glibc does. Returns nullptr for values it does not handle, which
+/// are infinities, NaNs and magnitudes of 2^63 and above.
+char *formatF64(char *P, double V) {
+#ifdef __SIZEOF_INT128__
+  typedef unsigned __int128 uint128_t;
+
+  uint64_t Bits;
+  memcpy(&Bits, &V, sizeof(Bits));
+  bool Neg = Bits >> 63;
+  int BiasedExp = (Bits >> 52) & 0x7ff;
+  uint64_t Mantissa = Bits & ((uint64_t(1) << 52) - 1);
+  if (BiasedExp == 0x7ff)
+    return nullptr;
+
+  // V = Mantissa * 2^Exp exactly.
+  int Exp;
+  if (BiasedExp == 0) {
+    Exp = -1074;
+  } else {
+    Mantissa |= uint64_t(1) << 52;
+    Exp = BiasedExp - 1075;
+  }
+  if (Exp > 10)
+    return nullptr;
+
+  uint64_t Int, Micros = 0;
+  if (Exp >= 0) {
+    Int = Mantissa << Exp;
+  } else {
+    int Shift = -Exp;
+    Int = Shift < 64 ? Mantissa >> Shift : 0;
+    uint64_t Frac =
+        Shift < 64 ? Mantissa & ((uint64_t(1) << Shift) - 1) : Mantissa;
+    // Frac * 10^6 < 2^73, so anything shifted right by more than 100 bits is
+    // below half a unit of the last decimal and rounds to 0.
+    if (Shift <= 100) {
+      uint128_t Scaled = (uint128_t)Frac * 1000000;
+      uint128_t Quot = Scaled >> Shift;
+      uint128_t Rem = Scaled - (Quot << Shift);
+      uint128_t Half = (uint128_t)1 << (Shift - 1);
+      Micros = (uint64_t)Quot;
+      if (Rem > Half || (Rem == Half && (Micros & 1)))
+        ++Micros;
+      if (Micros == 1000000) {
+        Micros = 0;
+        ++Int;
+      }
+    }
+  }
+
+  if (Neg)
+    *P++ = '-';
+  P = formatU64(P, Int);
+  *P++ = '.';
+  for (int i = 5; i >= 0; --i) {
+    P[i] = '0' + Micros % 10;
+    Micros /= 10;
+  }
+  return P + 6;
+#else
+  return nullptr;
+#endif
+}
+
+__attribute__((constructor)) void registerFlush() { atexit(cx_flush); }
+
+} // namespace
+
+extern "C" {
+
+void cx_write_i32(int32_t V) {
+  char *Start = reserve(11);
+  char *P = formatU64(Start, (uint32_t)V);
+  *P++ = '\n';
+  OutLen += P - Start;
+}
+
+void cx_write_f64(double V) {
+  char *Start = reserve(MaxF64Line);
+  if (char *P = formatF64(Start, V)) {
+    *P++ = '\n';
+    OutLen += P - Start;
+    return;
+  }
+
+  // Rare cases go through the C library. The longest is -DBL_MAX, with 309
+  // integer digits.
+  char Tmp[400];
+  int N = snprintf(Tmp, sizeof(Tmp), "%f\n", V);
+  if (N <= 0)
+    return;
+  memcpy(reserve(N), Tmp, N);
+  OutLen += N;
+}
+
+void cx_flush(void) {
+  writeAll(OutBuf, OutLen);
+  OutLen = 0;
+}
+}
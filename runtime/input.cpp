@@ -0,0 +1,236 @@
+#include "cxrt.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/// Block that stdin is read into when it cannot be mapped.
+char InBuf[1 << 16];
+
+/// Unread input is [Pos, End). It lives in InBuf, or in the mapping of stdin
+/// if stdin is a regular file.
+const char *Pos = InBuf;
+const char *End = InBuf;
+bool Initialized = false;
+/// Whether all of stdin has already been mapped or read.
+bool AtEOF = false;
+/// Whether stdin may wait for input, such as a terminal or a pipe.
+bool Interactive = false;
+
+/// Map what remains of stdin if it is a regular file.
+void initInput() {
+  Initialized = true;
+
+  struct stat St;
+  if (fstat(0, &St) != 0 || !S_ISREG(St.st_mode)) {
+    Interactive = true;
+    return;
+  }
+
+  off_t Offset = lseek(0, 0, SEEK_CUR);
+  if (Offset < 0 || Offset >= St.st_size)
+    return;
+
+  off_t PageSize = sysconf(_SC_PAGESIZE);
+  off_t MapOffset = Offset / PageSize * PageSize;
+  size_t MapSize = St.st_size - MapOffset;
+  void *Map = mmap(nullptr, MapSize, PROT_READ, MAP_PRIVATE, 0, MapOffset);
+  if (Map == MAP_FAILED)
+    return;
+  madvise(Map, MapSize, MADV_SEQUENTIAL);
+
+  Pos = (const char *)Map + (Offset - MapOffset);
+  End = (const char *)Map + MapSize;
+  AtEOF = true;
+}
+
+/// Keep the unread input and read one more block after it.
+/// @return Whether any byte was added.
+bool refill() {
+  if (AtEOF)
+    return false;
+
+  size_t Kept = End - Pos;
+  if (Kept == sizeof(InBuf))
+    return false;
+  memmove(InBuf, Pos, Kept);
+  Pos = InBuf;
+  End = InBuf + Kept;
+
+  // Whatever the program wrote may be a prompt for what it is waiting for.
+  if (Interactive)
+    cx_flush();
+
+  for (;;) {
+    ssize_t N = read(0, InBuf + Kept, sizeof(InBuf) - Kept);
+    if (N > 0) {
+      End += N;
+      return true;
+    }
+    if (N < 0 && errno == EINTR)
+      continue;
+    AtEOF = true;
+    return false;
+  }
+}
+
+bool isSpace(char C) { return C == ' ' || (C >= '\t' && C <= '\r'); }
+bool isDigit(char C) { return C >= '0' && C <= '9'; }
+
+/// Skip whitespace, like `scanf` does before a number, and get the following
+/// token into the buffer as a whole.
+/// @return Whether there is a token before the end of input.
+bool nextToken() {
+  for (;;) {
+    while (Pos != End && isSpace(*Pos))
+      ++Pos;
+    if (Pos != End)
+      break;
+    if (!refill())
+      return false;
+  }
+
+  // A number ends at the first whitespace. Waiting for it is fine even on a
+  // terminal, where the line ends with one.
+  size_t Len = 0;
+  for (;;) {
+    while (Pos + Len != End && !isSpace(Pos[Len]))
+      ++Len;
+    if (Pos + Len != End || !refill())
+      return true;
+  }
+}
+
+/// Parse an integer as `%u` does: an optional sign and decimal digits, with
+/// the value taken modulo 2^32.
+bool parseU32(uint32_t &V) {
+  const char *P = Pos;
+  bool Neg = false;
+  if (P != End && (*P == '+' || *P == '-'))
+    Neg = *P++ == '-';
+  if (P == End || !isDigit(*P))
+    return false;
+
+  uint32_t R = 0;
+  while (P != End && isDigit(*P))
+    R = R * 10 + (*P++ - '0');
+  V = Neg ? 0 - R : R;
+  Pos = P;
+  return true;
+}
+
+/// Parse a decimal double whose value can be computed exactly with one
+/// multiplication or division by a power of 10, which is the case for nearly
+/// all numbers in practice.
+/// @return Whether it could. Otherwise nothing is consumed.
+bool parseF64Fast(double &V) {
+  static const double Pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                 1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                 1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  const char *P = Pos;
+  bool Neg = false;
+  if (P != End && (*P == '+' || *P == '-'))
+    Neg = *P++ == '-';
+
+  uint64_t Mantissa = 0;
+  int Digits = 0, Exp10 = 0;
+  bool Any = false;
+  for (; P != End && isDigit(*P); ++P, Any = true) {
+    if (Mantissa || *P != '0')
+      ++Digits;
+    Mantissa = Mantissa * 10 + (*P - '0');
+  }
+  if (P != End && *P == '.') {
+    for (++P; P != End && isDigit(*P); ++P, Any = true) {
+      if (Mantissa || *P != '0')
+        ++Digits;
+      Mantissa = Mantissa * 10 + (*P - '0');
+      --Exp10;
+    }
+  }
+  // More than 19 digits may have overflowed, and anything but a plain
+  // decimal, such as hexadecimal, infinity or NaN, is left to strtod.
+  if (!Any || Digits > 19 || (P != End && (*P == 'x' || *P == 'X')))
+    return false;
+
+  if (P != End && (*P == 'e' || *P == 'E')) {
+    const char *Q = P + 1;
+    bool ExpNeg = false;
+    if (Q != End && (*Q == '+' || *Q == '-'))
+      ExpNeg = *Q++ == '-';
+    // Without digits, the `e` is not part of the number.
+    if (Q != End && isDigit(*Q)) {
+      int Exp = 0;
+      for (; Q != End && isDigit(*Q); ++Q)
+        if (Exp < 10000)
+          Exp = Exp * 10 + (*Q - '0');
+      Exp10 += ExpNeg ? -Exp : Exp;
+      P = Q;
+    }
+  }
+
+  if (Mantissa > (uint64_t(1) << 53) || Exp10 < -22 || Exp10 > 22)
+    return false;
+  double R = (double)Mantissa;
+  R = Exp10 < 0 ? R / Pow10[-Exp10] : R * Pow10[Exp10];
+  V = Neg ? -R : R;
+  Pos = P;
+  return true;
+}
+
+/// Parse a double with strtod, which needs a NUL-terminated copy of the
+/// token.
+bool parseF64Slow(double &V) {
+  size_t Len = 0;
+  while (Pos + Len != End && !isSpace(Pos[Len]))
+    ++Len;
+
+  char Small[128];
+  char *Tmp = Len < sizeof(Small) ? Small : (char *)malloc(Len + 1);
+  if (!Tmp)
+    return false;
+  memcpy(Tmp, Pos, Len);
+  Tmp[Len] = '\0';
+
+  char *TmpEnd;
+  double R = strtod(Tmp, &TmpEnd);
+  bool Parsed = TmpEnd != Tmp;
+  if (Parsed) {
+    V = R;
+    Pos += TmpEnd - Tmp;
+  }
+  if (Tmp != Small)
+    free(Tmp);
+  return Parsed;
+}
+
+} // namespace
+
+extern "C" {
+
+int32_t cx_read_i32(void) {
+  if (!Initialized)
+    initInput();
+  uint32_t V = 0;
+  if (nextToken())
+    parseU32(V);
+  return (int32_t)V;
+}
+
+double cx_read_f64(void) {
+  if (!Initialized)
+    initInput();
+  double V = 0;
+  if (nextToken() && !parseF64Fast(V))
+    parseF64Slow(V);
+  return V;
+}
+
+bool cx_read_bool(void) { return cx_read_i32() != 0; }
+}
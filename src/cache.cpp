@@ -0,0 +1,191 @@
+#include "cache.h"
+#include "lexer.h"
+#include <chrono>
+#include <cstdio>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/CachePruning.h>
+#include <llvm/Support/Chrono.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Support/raw_ostream.h>
+
+template <typename HasherT, typename T>
+static void HashValue(HasherT &Hasher, T Value) {
+  Hasher.update(ArrayRef<uint8_t>((const uint8_t *)&Value, sizeof(Value)));
+}
+
+template <typename HasherT>
+static void HashString(HasherT &Hasher, StringRef Str) {
+  HashValue(Hasher, (uint64_t)Str.size());
+  Hasher.update(Str);
+}
+
+template <typename HasherT> void HashToken(HasherT &Hasher, int Tok) {
+  HashValue(Hasher, Tok);
+  switch (Tok) {
+  case tok_identifier:
+    HashString(Hasher, IdentifierStr);
+    break;
+  case tok_intliteral:
+    HashValue(Hasher, IntVal);
+    break;
+  case tok_doubleliteral:
+    HashValue(Hasher, NumVal);
+    break;
+  }
+}
+
+template void HashToken(MD5 &Hasher, int Tok);
+template void HashToken(SHA256 &Hasher, int Tok);
+
+/// Hash the tokens of the loaded source, and rewind it.
+static void HashTokens(SHA256 &Hasher) {
+  int Tok;
+  do {
+    Tok = gettok();
+    HashToken(Hasher, Tok);
+  } while (Tok != tok_eof);
+  RewindSource();
+}
+
+std::string GetCacheKey(ArrayRef<std::string> Files, StringRef Flags) {
+  SHA256 Hasher;
+
+  // A rebuilt compiler may generate different code for the same input.
+  HashString(Hasher, LLVM_VERSION_STRING);
+  auto Compiler = sys::fs::getMainExecutable(nullptr, (void *)&GetCacheKey);
+  sys::fs::file_status Status;
+  if (sys::fs::status(Compiler, Status))
+    return "";
+  HashValue(Hasher, Status.getSize());
+  HashValue(Hasher, sys::toTimeT(Status.getLastModificationTime()));
+
+  HashString(Hasher, sys::getDefaultTargetTriple());
+  HashString(Hasher, sys::getHostCPUName());
+  HashString(Hasher, Flags);
+
+  if (Files.size() <= 1) {
+    HashTokens(Hasher);
+  } else {
+    for (auto &File : Files) {
+      // Stdin cannot be read again to be compiled.
+      if (File == "-" || OpenSource(File))
+        return "";
+      HashTokens(Hasher);
+    }
+  }
+
+  return toHex(Hasher.final(), /*LowerCase=*/true);
+}
+
+/// Get the path of the cache entry of a key. The prefix is what
+/// `pruneCache()` looks for.
+static SmallString<128> GetEntryPath(const CacheOptions &Opts, StringRef Key) {
+  SmallString<128> Path(Opts.Dir);
+  sys::path::append(Path, "llvmcache-" + Key);
+  return Path;
+}
+
+/// Copy a cache entry to the output file.
+static int CopyEntry(StringRef Entry, const std::string &OutFile) {
+  if (OutFile == "-") {
+    auto Buffer = MemoryBuffer::getFile(Entry);
+    if (!Buffer)
+      return 1;
+    outs() << (*Buffer)->getBuffer();
+    outs().flush();
+    return 0;
+  }
+
+  if (sys::fs::copy_file(Entry, OutFile))
+    return 1;
+  // Executables stay executable.
+  auto Perms = sys::fs::getPermissions(Entry);
+  if (Perms)
+    sys::fs::setPermissions(OutFile, *Perms);
+  return 0;
+}
+
+bool FetchCachedOutput(const CacheOptions &Opts, StringRef Key,
+                       const std::string &OutFile) {
+  auto Entry = GetEntryPath(Opts, Key);
+
+  int FD;
+  if (sys::fs::openFileForRead(Entry, FD)) {
+    if (Opts.Report)
+      fprintf(stderr, "Cache miss: %s\n", Key.str().c_str());
+    return false;
+  }
+  // Eviction goes by access time, which the file system may not keep up to
+  // date by itself.
+  sys::fs::setLastAccessAndModificationTime(FD,
+                                            std::chrono::system_clock::now());
+  sys::fs::closeFile(FD);
+
+  if (CopyEntry(Entry, OutFile)) {
+    if (Opts.Report)
+      fprintf(stderr, "Cache miss: %s (cannot copy it out)\n",
+              Key.str().c_str());
+    return false;
+  }
+  if (Opts.Report)
+    fprintf(stderr, "Cache hit: %s\n", Key.str().c_str());
+  return true;
+}
+
+int EmitModuleCached(const CacheOptions &Opts, StringRef Key, Module &M,
+                     TargetMachine *TM, enum EmitKind Kind,
+                     const std::string &OutFile,
+                     const BitcodeOptions &BCOpts) {
+  auto Entry = GetEntryPath(Opts, Key);
+
+  if (auto EC = sys::fs::create_directories(Opts.Dir)) {
+    fprintf(stderr, "Warning: cannot create the cache '%s': %s\n",
+            Opts.Dir.c_str(), EC.message().c_str());
+    return EmitModule(M, TM, Kind, OutFile, BCOpts);
+  }
+
+  // Temporaries are removed on signals, but not if the compiler is killed
+  // outright. The prefix lets `pruneCache()` evict those too.
+  SmallString<128> Model(Opts.Dir);
+  sys::path::append(Model, "llvmcache-tmp-%%%%%%%%");
+  auto Temp = sys::fs::TempFile::create(Model);
+  if (!Temp) {
+    fprintf(stderr, "Warning: cannot write the cache '%s': %s\n",
+            Opts.Dir.c_str(), toString(Temp.takeError()).c_str());
+    return EmitModule(M, TM, Kind, OutFile, BCOpts);
+  }
+
+  if (EmitModule(M, TM, Kind, Temp->TmpName, BCOpts)) {
+    consumeError(Temp->discard());
+    return 1;
+  }
+  // Renaming is atomic, so other compilers see all of the entry or none.
+  if (auto Err = Temp->keep(Entry)) {
+    fprintf(stderr, "Warning: cannot write the cache '%s': %s\n",
+            Opts.Dir.c_str(), toString(std::move(Err)).c_str());
+    return EmitModule(M, TM, Kind, OutFile, BCOpts);
+  }
+
+  int ret = CopyEntry(Entry, OutFile);
+  if (ret)
+    fprintf(stderr, "Error: cannot write '%s'\n", OutFile.c_str());
+
+  // Evict the least recently used entries beyond the size limit. Outputs
+  // do not expire otherwise.
+  CachePruningPolicy Policy;
+  Policy.Interval = std::chrono::seconds(0);
+  Policy.Expiration = std::chrono::seconds(0);
+  Policy.MaxSizePercentageOfAvailableSpace = 0;
+  Policy.MaxSizeBytes = Opts.MaxBytes;
+  pruneCache(Opts.Dir, Policy);
+
+  return ret;
+}
@@ -0,0 +1,332 @@
+#include "driver.h"
+#include "incremental.h"
+#include "ir.h"
+#include "jit.h"
+#include "lexer.h"
+#include "memreport.h"
+#include "opt.h"
+#include "parallel.h"
+#include "parser.h"
+#include "timing.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Path.h>
+#include <string>
+#include <vector>
+
+static void PrintUsage(const char *Prog) {
+  fprintf(stderr,
+          "usage: %s [options] [file...]\n"
+          "  -O0, -O1, -O2, -O3  optimization level (default: -O0)\n"
+          "  -passes=<pipeline>  run a custom pass pipeline instead\n"
+          "  -time-passes        print the time spent in each pass\n"
+          "  -ftime-report[=<format>]\n"
+          "                      print the time spent in each phase, pass\n"
+          "                      and function, as a table (default) or json\n"
+          "  --mem-report[=<format>]\n"
+          "                      print the memory taken by the AST, symbol\n"
+          "                      tables, IR of each function and each phase\n"
+          "  -fsyntax-only       only check the program for errors\n"
+          "  -j <n>              generate IR on n threads, or compile up to\n"
+          "                      n files at once\n"
+          "  -S                  emit assembly\n"
+          "  -c                  emit an object file\n"
+          "  -o <file>           output file; links an executable unless\n"
+          "                      -S, -c or --emit is given\n"
+          "  --emit=<kind>       llvm (default), bc, asm, obj or exe\n"
+          "  --bc-hash           record a module hash in bitcode output\n"
+          "  --bc-symtab         write a symbol table into bitcode output\n"
+          "  -mcpu=<cpu>         target CPU (default: native)\n"
+          "  --run               JIT-compile the program and run its main\n"
+          "  --watch             rebuild the file whenever it changes,\n"
+          "                      regenerating the IR of only the\n"
+          "                      functions that do\n"
+          "  --cache-dir=<dir>   reuse outputs of earlier compilations kept\n"
+          "                      in dir\n"
+          "  --cache-size=<MiB>  size the cache is pruned to (default: 512;\n"
+          "                      0 for no limit)\n"
+          "  --cache-report      print every cache hit and miss\n"
+          "  --server[=<socket>] serve compilations from the cxc client on\n"
+          "                      a Unix socket (default: $CXC_SOCKET,\n"
+          "                      $XDG_RUNTIME_DIR/cxc.sock or\n"
+          "                      /tmp/cxc-<uid>/cxc.sock)\n",
+          Prog);
+}
+
+int ParseDriverArgs(int argc, char **argv, DriverOptions &Opts) {
+  bool HasEmitKind = false;
+
+  for (int i = 1; i < argc; ++i) {
+    StringRef Arg = argv[i];
+    if (Arg.size() == 3 && Arg.startswith("-O") && Arg[2] >= '0' &&
+        Arg[2] <= '3') {
+      Opts.OptLevel = Arg[2] - '0';
+    } else if (Arg.consume_front("-passes=") ||
+               Arg.consume_front("--passes=")) {
+      Opts.Pipeline = Arg.str();
+    } else if (Arg == "-time-passes" || Arg == "--time-passes") {
+      Opts.TimePasses = true;
+    } else if (Arg == "-ftime-report") {
+      Opts.TimeReport = true;
+      Opts.TimeReportJSON = false;
+    } else if (Arg.consume_front("-ftime-report=")) {
+      Opts.TimeReport = true;
+      if (Arg == "table")
+        Opts.TimeReportJSON = false;
+      else if (Arg == "json")
+        Opts.TimeReportJSON = true;
+      else {
+        fprintf(stderr, "Error: unknown time report format '%s'\n",
+                Arg.data());
+        return 1;
+      }
+    } else if (Arg == "--mem-report") {
+      Opts.MemReport = true;
+      Opts.MemReportJSON = false;
+    } else if (Arg.consume_front("--mem-report=")) {
+      Opts.MemReport = true;
+      if (Arg == "table")
+        Opts.MemReportJSON = false;
+      else if (Arg == "json")
+        Opts.MemReportJSON = true;
+      else {
+        fprintf(stderr, "Error: unknown memory report format '%s'\n",
+                Arg.data());
+        return 1;
+      }
+    } else if (Arg == "-fsyntax-only") {
+      Opts.SyntaxOnly = true;
+    } else if (Arg.consume_front("-j")) {
+      if (Arg.empty()) {
+        if (++i == argc) {
+          fprintf(stderr, "Error: missing thread count after '-j'\n");
+          return 1;
+        }
+        Arg = argv[i];
+      }
+      if (Arg.getAsInteger(10, Opts.Threads) || Opts.Threads == 0) {
+        fprintf(stderr, "Error: invalid thread count '%s'\n", Arg.data());
+        return 1;
+      }
+    } else if (Arg == "-S") {
+      HasEmitKind = true;
+      Opts.Kind = emit_asm;
+    } else if (Arg == "-c") {
+      HasEmitKind = true;
+      Opts.Kind = emit_obj;
+    } else if (Arg.consume_front("--emit=")) {
+      HasEmitKind = true;
+      if (Arg == "llvm")
+        Opts.Kind = emit_llvm;
+      else if (Arg == "bc")
+        Opts.Kind = emit_bc;
+      else if (Arg == "asm")
+        Opts.Kind = emit_asm;
+      else if (Arg == "obj")
+        Opts.Kind = emit_obj;
+      else if (Arg == "exe")
+        Opts.Kind = emit_exe;
+      else {
+        fprintf(stderr, "Error: unknown output kind '%s'\n", Arg.data());
+        return 1;
+      }
+    } else if (Arg == "--bc-hash") {
+      Opts.BCOpts.ModuleHash = true;
+    } else if (Arg == "--bc-symtab") {
+      Opts.BCOpts.Symtab = true;
+    } else if (Arg == "-o") {
+      if (++i == argc) {
+        fprintf(stderr, "Error: missing file name after '-o'\n");
+        return 1;
+      }
+      Opts.OutFile = argv[i];
+    } else if (Arg.consume_front("-mcpu=")) {
+      Opts.CPU = Arg.str();
+    } else if (Arg == "--run") {
+      Opts.Run = true;
+    } else if (Arg == "--watch") {
+      Opts.Watch = true;
+    } else if (Arg.consume_front("--cache-dir=")) {
+      Opts.Cache.Dir = Arg.str();
+    } else if (Arg.consume_front("--cache-size=")) {
+      if (Arg.getAsInteger(10, Opts.Cache.MaxBytes) ||
+          Opts.Cache.MaxBytes > UINT64_MAX >> 20) {
+        fprintf(stderr, "Error: invalid cache size '%s'\n", Arg.data());
+        return 1;
+      }
+      Opts.Cache.MaxBytes <<= 20;
+    } else if (Arg == "--cache-report") {
+      Opts.Cache.Report = true;
+    } else if (Arg == "--server" || Arg.consume_front("--server=")) {
+      Opts.Server = true;
+      if (Arg != "--server")
+        Opts.Socket = Arg.str();
+    } else if (Arg == "-h" || Arg == "--help") {
+      PrintUsage(argv[0]);
+      Opts.Help = true;
+      return 0;
+    } else if (Arg.startswith("-") && Arg != "-") {
+      fprintf(stderr, "Error: unexpected argument '%s'\n", argv[i]);
+      PrintUsage(argv[0]);
+      return 1;
+    } else {
+      Opts.InputFiles.push_back(argv[i]);
+    }
+  }
+
+  if (!HasEmitKind && !Opts.OutFile.empty())
+    Opts.Kind = emit_exe;
+
+  if (Opts.OutFile.empty()) {
+    // Several files are linked into one program, named as if from stdin.
+    StringRef Stem = Opts.InputFiles.size() == 1
+                         ? sys::path::stem(Opts.InputFiles[0])
+                         : "a";
+    switch (Opts.Kind) {
+    case emit_llvm:
+    case emit_asm:
+      Opts.OutFile = "-";
+      break;
+    case emit_bc:
+      Opts.OutFile = (Stem + ".bc").str();
+      break;
+    case emit_obj:
+      Opts.OutFile = (Stem + ".o").str();
+      break;
+    case emit_exe:
+      Opts.OutFile = "a.out";
+      break;
+    }
+  }
+
+  return 0;
+}
+
+int RunDriver(const DriverOptions &Opts) {
+  if (Opts.Watch) {
+    if (Opts.InputFiles.size() != 1 || Opts.InputFiles[0] == "-" ||
+        Opts.Run || Opts.SyntaxOnly || Opts.TimeReport || Opts.MemReport) {
+      fprintf(stderr, "Error: --watch takes a single source file, and no "
+                      "--run, -fsyntax-only, -ftime-report or "
+                      "--mem-report\n");
+      return 1;
+    }
+    // Code generation rewrites the IR even at -O0; writing it out does not.
+    bool InPlace = Opts.OptLevel == 0 && Opts.Pipeline.empty() &&
+                   (Opts.Kind == emit_llvm || Opts.Kind == emit_bc);
+    return WatchSource(
+        Opts.InputFiles[0], Opts.Threads,
+        [&] {
+          auto TM = InitializeTarget(*TheModule, Opts.CPU, Opts.OptLevel);
+          if (!TM || OptimizeModule(*TheModule, TM.get(), Opts.OptLevel,
+                                    Opts.Pipeline, Opts.TimePasses))
+            return 1;
+          return EmitModule(*TheModule, TM.get(), Opts.Kind, Opts.OutFile,
+                            Opts.BCOpts);
+        },
+        InPlace);
+  }
+
+  auto Start = std::chrono::steady_clock::now();
+  TimeReportEnabled = Opts.TimeReport;
+  MemReportEnabled = Opts.MemReport;
+  RecordPhaseMemory("startup");
+  // Called on the way out of every compilation that gets started.
+  auto Report = [&](int ret) {
+    if (Opts.TimeReport)
+      PrintTimeReport(Opts.TimeReportJSON,
+                      std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - Start)
+                          .count());
+    if (Opts.MemReport)
+      PrintMemReport(Opts.MemReportJSON);
+    return ret;
+  };
+
+  if (Opts.InputFiles.size() <= 1 &&
+      OpenSource(Opts.InputFiles.empty() ? "-" : Opts.InputFiles[0]))
+    return 1;
+
+  // Everything below is skipped if the same program was compiled to the
+  // same output before.
+  std::string CacheKey;
+  if (!Opts.Cache.Dir.empty() && !Opts.SyntaxOnly && !Opts.Run) {
+    std::string Flags = "-O" + std::to_string(Opts.OptLevel) +
+                        " -passes=" + Opts.Pipeline + " -mcpu=" + Opts.CPU +
+                        " --emit=" + std::to_string(Opts.Kind) +
+                        (Opts.BCOpts.ModuleHash ? " --bc-hash" : "") +
+                        (Opts.BCOpts.Symtab ? " --bc-symtab" : "");
+    CacheKey = GetCacheKey(Opts.InputFiles, Flags);
+    if (!CacheKey.empty() &&
+        FetchCachedOutput(Opts.Cache, CacheKey, Opts.OutFile))
+      return Report(0);
+  }
+
+  int ret;
+  if (Opts.InputFiles.size() > 1) {
+    if (!Opts.SyntaxOnly)
+      InitializeModule();
+    ret = CompileUnits(Opts.InputFiles, Opts.Threads, Opts.SyntaxOnly);
+    RecordPhaseMemory("front end");
+    if (Opts.SyntaxOnly)
+      return Report(ret);
+  } else {
+    // fprintf(stderr, "ready> ");
+    getNextToken();
+
+    if (Opts.SyntaxOnly) {
+      ret = MainLoop(/*SyntaxOnly=*/true, Opts.Threads);
+      RecordPhaseMemory("front end");
+      return Report(ret);
+    }
+
+    InitializeModule();
+
+    ret = MainLoop(/*SyntaxOnly=*/false, Opts.Threads);
+    RecordPhaseMemory("front end");
+  }
+
+  std::unique_ptr<TargetMachine> TM;
+  if (ret == 0) {
+    TM = InitializeTarget(*TheModule, Opts.CPU, Opts.OptLevel);
+    if (!TM)
+      ret = 1;
+  }
+
+  if (ret == 0) {
+    TimeScope Scope(time_opt);
+    ret = OptimizeModule(*TheModule, TM.get(), Opts.OptLevel, Opts.Pipeline,
+                         Opts.TimePasses);
+  }
+  if (ret == 0 && Opts.MemReport) {
+    for (auto &F : *TheModule)
+      if (!F.isDeclaration())
+        RecordFunctionIR(F, /*Optimized=*/true);
+    RecordPhaseMemory("opt");
+  }
+
+  if (ret == 0 && Opts.Run) {
+    // The program's own run time is not part of the report.
+    Report(ret);
+    Builder.reset();
+    if (RunModule(std::move(TheModule), std::move(TheContext), Opts.OptLevel,
+                  ret))
+      ret = 1;
+    return ret;
+  }
+
+  if (ret == 0) {
+    TimeScope Scope(time_emit);
+    if (!CacheKey.empty())
+      ret = EmitModuleCached(Opts.Cache, CacheKey, *TheModule, TM.get(),
+                             Opts.Kind, Opts.OutFile, Opts.BCOpts);
+    else
+      ret = EmitModule(*TheModule, TM.get(), Opts.Kind, Opts.OutFile,
+                       Opts.BCOpts);
+  }
+  RecordPhaseMemory("emit");
+
+  return Report(ret);
+}
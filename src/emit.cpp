@@ -0,0 +1,212 @@
+#include "emit.h"
+#include <cstdio>
+#include <cstdlib>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetOptions.h>
+#include <memory>
+
+CodeGenOpt::Level getCodeGenOptLevel(unsigned OptLevel) {
+  switch (OptLevel) {
+  case 0:
+    return CodeGenOpt::None;
+  case 1:
+    return CodeGenOpt::Less;
+  case 2:
+    return CodeGenOpt::Default;
+  default:
+    return CodeGenOpt::Aggressive;
+  }
+}
+
+std::unique_ptr<TargetMachine>
+InitializeTarget(Module &M, const std::string &CPU, unsigned OptLevel) {
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+
+  auto TargetTriple = sys::getDefaultTargetTriple();
+  std::string Error;
+  auto Target = TargetRegistry::lookupTarget(TargetTriple, Error);
+  if (!Target) {
+    fprintf(stderr, "Error: %s\n", Error.c_str());
+    return nullptr;
+  }
+
+  std::string TargetCPU = CPU;
+  std::string Features;
+  if (CPU.empty() || CPU == "native") {
+    TargetCPU = sys::getHostCPUName().str();
+
+    StringMap<bool> HostFeatures;
+    if (sys::getHostCPUFeatures(HostFeatures)) {
+      for (auto &Feature : HostFeatures) {
+        if (!Features.empty())
+          Features += ',';
+        Features += Feature.second ? '+' : '-';
+        Features += Feature.first();
+      }
+    }
+  }
+
+  std::unique_ptr<TargetMachine> TM(Target->createTargetMachine(
+      TargetTriple, TargetCPU, Features, TargetOptions(), Reloc::PIC_, {},
+      getCodeGenOptLevel(OptLevel)));
+  if (!TM) {
+    fprintf(stderr, "Error: cannot create target machine for '%s'\n",
+            TargetTriple.c_str());
+    return nullptr;
+  }
+
+  M.setTargetTriple(TargetTriple);
+  M.setDataLayout(TM->createDataLayout());
+  return TM;
+}
+
+/// Check that everything written to a stream made it. A stream destroyed
+/// with an error pending aborts the compiler instead.
+static int CheckStream(raw_fd_ostream &Dest, StringRef Name) {
+  Dest.flush();
+  if (!Dest.has_error())
+    return 0;
+  fprintf(stderr, "Error: cannot write '%s': %s\n", Name.str().c_str(),
+          Dest.error().message().c_str());
+  Dest.clear_error();
+  return 1;
+}
+
+static int EmitNative(Module &M, TargetMachine *TM, raw_fd_ostream &Dest,
+                      CodeGenFileType FileType) {
+  // The object writer goes back to patch what it has written, which a pipe
+  // cannot do, so the output is built in memory then.
+  std::unique_ptr<buffer_ostream> Buffered;
+  raw_pwrite_stream *OS = &Dest;
+  if (!Dest.supportsSeeking()) {
+    Buffered = std::make_unique<buffer_ostream>(Dest);
+    OS = Buffered.get();
+  }
+
+  legacy::PassManager PM;
+  if (TM->addPassesToEmitFile(PM, *OS, nullptr, FileType)) {
+    fprintf(stderr, "Error: the target cannot emit a file of this type\n");
+    return 1;
+  }
+  PM.run(M);
+  return 0;
+}
+
+static int EmitBitcode(Module &M, raw_fd_ostream &Dest, StringRef Name,
+                       const BitcodeOptions &BCOpts) {
+  if (Dest.is_displayed()) {
+    fprintf(stderr, "Error: refusing to write bitcode to a terminal\n");
+    return 1;
+  }
+
+  // Build the whole file in memory and hand it to the stream in one write.
+  SmallVector<char, 0> Buffer;
+  Buffer.reserve(256 * 1024);
+  BitcodeWriter Writer(Buffer);
+  Writer.writeModule(M, /*ShouldPreserveUseListOrder=*/false, nullptr,
+                     BCOpts.ModuleHash);
+  if (BCOpts.Symtab)
+    Writer.writeSymtab();
+  Writer.writeStrtab();
+
+  Dest.write(Buffer.data(), Buffer.size());
+  return CheckStream(Dest, Name);
+}
+
+static int LinkExecutable(Module &M, TargetMachine *TM,
+                          const std::string &OutFile) {
+  int FD;
+  SmallString<128> ObjPath;
+  if (auto EC = sys::fs::createTemporaryFile("cxc", "o", FD, ObjPath)) {
+    fprintf(stderr, "Error: cannot create temporary file: %s\n",
+            EC.message().c_str());
+    return 1;
+  }
+
+  {
+    raw_fd_ostream Obj(FD, /*shouldClose=*/true);
+    int ret = EmitNative(M, TM, Obj, CGFT_ObjectFile);
+    if (CheckStream(Obj, ObjPath) || ret) {
+      sys::fs::remove(ObjPath);
+      return 1;
+    }
+  }
+
+  const char *CC = getenv("CC");
+  auto Linker = sys::findProgramByName(CC && *CC ? CC : "cc");
+  if (!Linker) {
+    fprintf(stderr, "Error: cannot find a C compiler driver to link with\n");
+    sys::fs::remove(ObjPath);
+    return 1;
+  }
+
+  // The runtime library is installed next to the compiler.
+  SmallString<128> RuntimePath(
+      sys::fs::getMainExecutable(nullptr, (void *)&EmitModule));
+  sys::path::remove_filename(RuntimePath);
+  sys::path::append(RuntimePath, "libcxrt.a");
+  if (!sys::fs::exists(RuntimePath)) {
+    fprintf(stderr, "Error: cannot find the runtime library '%s'\n",
+            RuntimePath.c_str());
+    sys::fs::remove(ObjPath);
+    return 1;
+  }
+
+  StringRef Args[] = {*Linker, "-o", OutFile, ObjPath, RuntimePath};
+  std::string ErrMsg;
+  int ret = sys::ExecuteAndWait(*Linker, Args, {}, {}, 0, 0, &ErrMsg);
+  sys::fs::remove(ObjPath);
+
+  if (ret != 0) {
+    fprintf(stderr, "Error: linking '%s' failed%s%s\n", OutFile.c_str(),
+            ErrMsg.empty() ? "" : ": ", ErrMsg.c_str());
+    return 1;
+  }
+  return 0;
+}
+
+int EmitModule(Module &M, TargetMachine *TM, enum EmitKind Kind,
+               const std::string &OutFile, const BitcodeOptions &BCOpts) {
+  if (Kind == emit_exe)
+    return LinkExecutable(M, TM, OutFile);
+
+  std::error_code EC;
+  raw_fd_ostream Dest(OutFile, EC,
+                      Kind == emit_llvm || Kind == emit_asm ? sys::fs::OF_Text
+                                                            : sys::fs::OF_None);
+  if (EC) {
+    fprintf(stderr, "Error: cannot open '%s': %s\n", OutFile.c_str(),
+            EC.message().c_str());
+    return 1;
+  }
+
+  int ret = 0;
+  switch (Kind) {
+  case emit_llvm:
+    M.print(Dest, nullptr);
+    break;
+  case emit_bc:
+    return EmitBitcode(M, Dest, OutFile, BCOpts);
+  case emit_asm:
+    ret = EmitNative(M, TM, Dest, CGFT_AssemblyFile);
+    break;
+  case emit_obj:
+    ret = EmitNative(M, TM, Dest, CGFT_ObjectFile);
+    break;
+  case emit_exe:
+    break; // Handled above.
+  }
+  return CheckStream(Dest, OutFile) || ret;
+}
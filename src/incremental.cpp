@@ -0,0 +1,263 @@
+#include "incremental.h"
+#include "cache.h"
+#include "ir.h"
+#include "lexer.h"
+#include "parallel.h"
+#include "parser.h"
+#include "sema.h"
+#include "symbol.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MD5.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+using Digest = MD5::MD5Result;
+
+/**
+ * @brief What the last successful build knows about a function definition.
+ */
+struct FunctionRecord {
+  /**
+   * @brief Hash of the prototype and the body tokens.
+   */
+  Digest BodyKey;
+  /**
+   * @brief Globals and functions the body refers to, sorted.
+   */
+  SmallVector<SymbolID, 4> Deps;
+  /**
+   * @brief Hash of BodyKey and of the signatures of Deps.
+   */
+  Digest Fingerprint;
+};
+} // namespace
+
+static thread_local bool Incremental = false;
+
+/// The unoptimized module of the last successful build, whose functions are
+/// moved into the next one when unchanged, and what it was built from.
+static std::unique_ptr<Module> LastModule;
+static DenseMap<SymbolID, FunctionRecord> Records;
+
+/// What the build going on records, kept once it succeeds.
+static DenseMap<SymbolID, FunctionRecord> NewRecords;
+/// Functions whose bodies are moved over from LastModule, in source order.
+static std::vector<SymbolID> Reused;
+/// Body key of the definition being parsed, and the names it refers to.
+static Digest CurBodyKey;
+static SmallVector<SymbolID, 16> CurDeps;
+
+template <typename T> static void HashValue(MD5 &Hasher, T Value) {
+  Hasher.update(ArrayRef<uint8_t>((const uint8_t *)&Value, sizeof(Value)));
+}
+
+static void HashParam(MD5 &Hasher, VarDeclAST *Param) {
+  HashValue(Hasher, Param->getType());
+  HashValue(Hasher, Param->isConstVar());
+}
+
+/// Hash what the IR of a body depends on besides its own tokens: the
+/// signatures of the globals and functions it uses, as they are declared
+/// where the body is.
+static Digest GetFingerprint(const Digest &BodyKey,
+                             ArrayRef<SymbolID> Deps) {
+  MD5 Hasher;
+  HashValue(Hasher, BodyKey);
+  for (auto Name : Deps) {
+    HashValue(Hasher, Name);
+    if (auto *Proto = FunctionDecls.lookup(Name)) {
+      HashValue(Hasher, 'f');
+      HashValue(Hasher, Proto->getRetType());
+      for (auto *Param : Proto->getArgs())
+        HashParam(Hasher, Param);
+    } else {
+      auto It = GlobalDecls.find(Name);
+      if (It != GlobalDecls.end()) {
+        HashValue(Hasher, 'g');
+        HashValue(Hasher, It->second.Type);
+        HashValue(Hasher, It->second.isConst);
+      }
+    }
+  }
+  Digest Fingerprint;
+  Hasher.final(Fingerprint);
+  return Fingerprint;
+}
+
+bool isIncrementalBuild() { return Incremental; }
+
+bool SkipUnchangedBody(PrototypeAST *Proto) {
+  auto Name = Proto->getName();
+  CurDeps.clear();
+
+  // Parameter names end up in the IR, so they are part of the key.
+  MD5 Hasher;
+  HashValue(Hasher, Proto->getRetType());
+  for (auto *Param : Proto->getArgs()) {
+    HashParam(Hasher, Param);
+    HashValue(Hasher, Param->getName());
+  }
+
+  auto Start = getTokenPosition();
+  int Tok = '{';
+  unsigned Depth = 0;
+  do {
+    if (Tok == tok_eof)
+      break;
+    HashToken(Hasher, Tok);
+    if (Tok == '{')
+      ++Depth;
+    else if (Tok == '}')
+      --Depth;
+    Tok = getNextToken();
+  } while (Depth);
+  Hasher.final(CurBodyKey);
+
+  auto It = Records.find(Name);
+  if (Depth == 0 && It != Records.end() &&
+      It->second.BodyKey == CurBodyKey &&
+      GetFingerprint(CurBodyKey, It->second.Deps) == It->second.Fingerprint) {
+    auto *F = LastModule->getFunction(getSymbolName(Name));
+    if (F && !F->isDeclaration())
+      return true;
+  }
+
+  SeekSource(Start);
+  getNextToken();
+  return false;
+}
+
+int AddIncrementalFunction(FunctionAST *F, std::unique_ptr<ASTArena> Nodes) {
+  auto *Proto = F->getProto();
+  auto Name = Proto->getName();
+
+  if (!F->getBody()) {
+    NewRecords[Name] = Records.lookup(Name);
+    Reused.push_back(Name);
+    // Declared here, the function takes the place it would if it were
+    // generated.
+    if (!NamedFunctions.lookup(Name) && !Proto->codegen())
+      return 1;
+    return 0;
+  }
+
+  // A recursive call is covered by the prototype in the body key.
+  llvm::sort(CurDeps);
+  CurDeps.erase(std::unique(CurDeps.begin(), CurDeps.end()), CurDeps.end());
+  CurDeps.erase(std::remove(CurDeps.begin(), CurDeps.end(), Name),
+                CurDeps.end());
+  auto &Record = NewRecords[Name];
+  Record.BodyKey = CurBodyKey;
+  Record.Deps.assign(CurDeps.begin(), CurDeps.end());
+  Record.Fingerprint = GetFingerprint(CurBodyKey, Record.Deps);
+
+  return QueueFunction(F, std::move(Nodes));
+}
+
+/// Build the loaded source into LastModule, reusing what it can.
+/// @param Regenerated Set to the number of functions generated anew.
+static int Build(unsigned Threads, unsigned &Regenerated) {
+  getNextToken();
+  InitializePartModule();
+
+  NewRecords.clear();
+  Reused.clear();
+  Incremental = true;
+  ReferencedNames = &CurDeps;
+  int ret = MainLoop(/*SyntaxOnly=*/false, Threads);
+  ReferencedNames = nullptr;
+  Incremental = false;
+
+  if (ret) {
+    TheModule.reset();
+    return ret;
+  }
+
+  if (LastModule) {
+    SmallVector<Function *, 0> Functions;
+    for (auto Name : Reused)
+      Functions.push_back(LastModule->getFunction(getSymbolName(Name)));
+    MoveFunctions(*LastModule, Functions);
+  }
+  Regenerated = NewRecords.size() - Reused.size();
+  LastModule = std::move(TheModule);
+  Records = std::move(NewRecords);
+  NewRecords.clear();
+  return 0;
+}
+
+/// Build the source file, emit it and report how long it took.
+static void Rebuild(const std::string &File, unsigned Threads,
+                    function_ref<int()> Emit, bool InPlace) {
+  auto Start = std::chrono::steady_clock::now();
+  unsigned Regenerated = 0;
+  int ret = OpenSource(File);
+  if (ret == 0)
+    ret = Build(Threads, Regenerated);
+  auto Built = std::chrono::steady_clock::now();
+  if (ret == 0 && InPlace) {
+    TheModule = std::move(LastModule);
+    ret = Emit();
+    LastModule = std::move(TheModule);
+  } else if (ret == 0) {
+    // Optimization changes the module, which is still needed as it is.
+    TheModule = CloneModule(*LastModule);
+    ret = Emit();
+    TheModule.reset();
+  }
+  auto End = std::chrono::steady_clock::now();
+
+  auto Ms = [](std::chrono::steady_clock::duration D) {
+    return std::chrono::duration<double, std::milli>(D).count();
+  };
+  if (ret)
+    fprintf(stderr, "Build of '%s' failed; waiting for changes\n",
+            File.c_str());
+  else
+    fprintf(stderr,
+            "Built '%s' in %.1f ms (IR in %.1f ms); %u of %u functions "
+            "regenerated\n",
+            File.c_str(), Ms(End - Start), Ms(Built - Start), Regenerated,
+            (unsigned)Records.size());
+}
+
+int WatchSource(const std::string &File, unsigned Threads,
+                function_ref<int()> Emit, bool InPlace) {
+  if (Threads == 0)
+    Threads = hardware_concurrency().compute_thread_count();
+
+  // The modification time and size of the file when it was last built and
+  // when it was last looked at. Editors may take a while to write the file,
+  // so it is only built again once they stay the same between two looks.
+  using Stamp = std::pair<sys::TimePoint<>, uint64_t>;
+  Stamp Built, Seen;
+  bool First = true;
+  while (true) {
+    sys::fs::file_status Status;
+    if (!sys::fs::status(File, Status)) {
+      Stamp Now(Status.getLastModificationTime(), Status.getSize());
+      if (First || (Now != Built && Now == Seen)) {
+        Rebuild(File, Threads, Emit, InPlace);
+        Built = Now;
+        First = false;
+      }
+      Seen = Now;
+    } else if (First) {
+      fprintf(stderr, "Error: cannot watch '%s'\n", File.c_str());
+      return 1;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
@@ -1,24 +1,54 @@
 #include "ir.h"
 #include "AST.h"
 #include "lexer.h"
+#include "memreport.h"
 #include "parser.h"
+#include "timing.h"
 #include <llvm/ADT/APFloat.h>
 #include <llvm/ADT/APInt.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/Casting.h>
 #include <memory>
 #include <utility>
 
-std::unique_ptr<LLVMContext> TheContext;
-std::unique_ptr<Module> TheModule;
-std::unique_ptr<IRBuilder<>> Builder;
-std::map<std::string, std::pair<bool, AllocaInst *>> NamedValues;
-std::map<std::string, std::unique_ptr<PrototypeAST>> NamedFns;
-std::set<std::string> TakenNames;
-BasicBlock *ContDest = nullptr;
-BasicBlock *BrkDest = nullptr;
+thread_local std::unique_ptr<LLVMContext> TheContext;
+thread_local std::unique_ptr<Module> TheModule;
+thread_local std::unique_ptr<IRBuilder<>> Builder;
+thread_local DenseMap<const VarDeclAST *, AllocaInst *> LocalValues;
+thread_local DenseMap<SymbolID, GlobalVariable *> NamedGlobals;
+thread_local DenseMap<SymbolID, Function *> NamedFunctions;
+static thread_local BasicBlock *ContDest = nullptr;
+static thread_local BasicBlock *BrkDest = nullptr;
+
+/// Declare `exit` and the input and output functions of the runtime in
+/// TheModule.
+static void DeclareRuntimeFunctions() {
+  Function::Create(
+      FunctionType::get(Builder->getInt32Ty(), Builder->getInt32Ty(), false),
+      Function::ExternalLinkage, "exit", *TheModule);
+
+  // Input and output go through the runtime in cxrt.h.
+  Function::Create(FunctionType::get(Builder->getInt32Ty(), false),
+                   Function::ExternalLinkage, "cx_read_i32", *TheModule);
+  Function::Create(FunctionType::get(Builder->getDoubleTy(), false),
+                   Function::ExternalLinkage, "cx_read_f64", *TheModule);
+  auto *ReadBool =
+      Function::Create(FunctionType::get(Builder->getInt1Ty(), false),
+                       Function::ExternalLinkage, "cx_read_bool", *TheModule);
+  // A C `bool` comes back zero-extended to a byte.
+  ReadBool->addRetAttr(Attribute::ZExt);
+  Function::Create(FunctionType::get(Builder->getVoidTy(),
+                                     Builder->getInt32Ty(), false),
+                   Function::ExternalLinkage, "cx_write_i32", *TheModule);
+  Function::Create(FunctionType::get(Builder->getVoidTy(),
+                                     Builder->getDoubleTy(), false),
+                   Function::ExternalLinkage, "cx_write_f64", *TheModule);
+}
 
 void InitializeModule() {
   TheContext = std::make_unique<LLVMContext>();
@@ -26,20 +56,21 @@ void InitializeModule() {
 
   Builder = std::make_unique<IRBuilder<>>(*TheContext);
 
-  Builder->CreateGlobalString("%u\n", "outfmt_int", 0, TheModule.get());
-  Builder->CreateGlobalString("%f\n", "outfmt_double", 0, TheModule.get());
-  Builder->CreateGlobalString("%u", "infmt_int", 0, TheModule.get());
-  Builder->CreateGlobalString("%f", "infmt_double", 0, TheModule.get());
+  NamedGlobals.clear();
+  NamedFunctions.clear();
+  DeclareRuntimeFunctions();
+}
 
-  Function::Create(
-      FunctionType::get(Builder->getInt32Ty(), Builder->getInt8PtrTy(), true),
-      Function::ExternalLinkage, "printf", *TheModule);
-  Function::Create(
-      FunctionType::get(Builder->getInt32Ty(), Builder->getInt8PtrTy(), true),
-      Function::ExternalLinkage, "scanf", *TheModule);
-  Function::Create(
-      FunctionType::get(Builder->getInt32Ty(), Builder->getInt32Ty(), false),
-      Function::ExternalLinkage, "exit", *TheModule);
+void InitializePartModule() {
+  if (!TheContext) {
+    TheContext = std::make_unique<LLVMContext>();
+    Builder = std::make_unique<IRBuilder<>>(*TheContext);
+  }
+  TheModule = std::make_unique<Module>("CXC", *TheContext);
+
+  NamedGlobals.clear();
+  NamedFunctions.clear();
+  DeclareRuntimeFunctions();
 }
 
 Value *LogErrorV(const char *Str) {
@@ -62,275 +93,128 @@ Type *llvmTypeFromCXType(const enum CXType T) {
 }
 
 Value *IntExprAST::codegen() {
-  setCXType(typ_int);
   return ConstantInt::get(*TheContext, APInt(32, Val));
 }
 
 Value *DoubleExprAST::codegen() {
-  setCXType(typ_double);
   return ConstantFP::get(*TheContext, APFloat(Val));
 }
 
 Value *BooleanExprAST::codegen() {
-  setCXType(typ_bool);
   return ConstantInt::get(*TheContext, APInt(1, Val));
 }
 
-Value *VariableExprAST::codegen() {
-  AllocaInst *A = NamedValues[Name].second;
-  if (!A) {
-    auto *G = TheModule->getNamedGlobal(Name);
-    if (!G)
-      return LogErrorV("Unknown variable name");
-
-    if (G->getValueType() == Type::getInt32Ty(*TheContext))
-      setCXType(typ_int);
-    if (G->getValueType() == Type::getInt1Ty(*TheContext))
-      setCXType(typ_bool);
-    if (G->getValueType() == Type::getDoubleTy(*TheContext))
-      setCXType(typ_double);
-
-    return Builder->CreateLoad(G->getValueType(), G, Name.c_str());
-  }
-
-  if (A->getAllocatedType() == Type::getInt32Ty(*TheContext))
-    setCXType(typ_int);
-  if (A->getAllocatedType() == Type::getInt1Ty(*TheContext))
-    setCXType(typ_bool);
-  if (A->getAllocatedType() == Type::getDoubleTy(*TheContext))
-    setCXType(typ_double);
+/**
+ * Get the address of the variable that semantic analysis bound a variable
+ * expression to.
+ */
+static Value *getVariableAddress(VariableExprAST *Var) {
+  if (auto *D = Var->getDecl())
+    return LocalValues.lookup(D);
+  if (auto *G = NamedGlobals.lookup(Var->getName()))
+    return G;
+
+  // A part module only declares the globals its functions use. The
+  // definition is in the module it is linked into.
+  auto *G = new GlobalVariable(
+      *TheModule, llvmTypeFromCXType(Var->getCXType()), false,
+      GlobalValue::ExternalLinkage, nullptr, getSymbolName(Var->getName()));
+  NamedGlobals[Var->getName()] = G;
+  return G;
+}
 
-  return Builder->CreateLoad(A->getAllocatedType(), A, Name.c_str());
+Value *VariableExprAST::codegen() {
+  return Builder->CreateLoad(llvmTypeFromCXType(getCXType()),
+                             getVariableAddress(this), getSymbolName(Name));
 }
 
 Value *BinaryExprAST::codegen() {
   if (Op == '=') {
-    VariableExprAST *LHSE = dynamic_cast<VariableExprAST *>(LHS.get());
-    if (!LHSE)
-      return LogErrorV("destination of '=' must be a variable");
-
-    AllocaInst *Variable = NamedValues[LHSE->getName()].second;
-    if (!Variable) {
-      auto *G = TheModule->getNamedGlobal(LHSE->getName());
-      if (!G)
-        return LogErrorV("Unknown variable name");
-
-      if (G->isConstant())
-        return LogErrorV("Can't assign to const variables");
-
-      Value *Val = RHS->codegen();
-      if (!Val)
-        return nullptr;
-
-      if (G->getValueType() == Type::getInt32Ty(*TheContext))
-        setCXType(typ_int);
-      if (G->getValueType() == Type::getInt1Ty(*TheContext))
-        setCXType(typ_bool);
-      if (G->getValueType() == Type::getDoubleTy(*TheContext))
-        setCXType(typ_double);
-
-      Builder->CreateStore(Val, G);
-      return Val;
-    }
-
-    if (NamedValues[LHSE->getName()].first)
-      return LogErrorV("Can't assign to const variables");
-
     Value *Val = RHS->codegen();
     if (!Val)
       return nullptr;
 
-    if (Variable->getAllocatedType() == Type::getInt32Ty(*TheContext))
-      setCXType(typ_int);
-    if (Variable->getAllocatedType() == Type::getInt1Ty(*TheContext))
-      setCXType(typ_bool);
-    if (Variable->getAllocatedType() == Type::getDoubleTy(*TheContext))
-      setCXType(typ_double);
+    Builder->CreateStore(Val,
+                         getVariableAddress(cast<VariableExprAST>(LHS)));
+    return Val;
+  }
 
-    if (RHS->getCXType() != getCXType())
-      return LogErrorV("Different types on each side of '='");
+  // Lower the left spine of a chain like `a + b - c * d + ...` bottom-up in a
+  // loop, so that long chains do not nest codegen() calls.
+  SmallVector<BinaryExprAST *, 8> Spine;
+  Spine.push_back(this);
+  while (auto *B = dyn_cast<BinaryExprAST>(Spine.back()->LHS)) {
+    if (B->Op == '=')
+      break;
+    Spine.push_back(B);
+  }
 
-    Builder->CreateStore(Val, Variable);
-    return Val;
+  Value *L = Spine.back()->LHS->codegen();
+  for (auto *B : reverse(Spine)) {
+    L = B->codegenOperator(L);
+    if (!L)
+      return nullptr;
   }
+  return L;
+}
 
-  Value *L = LHS->codegen();
+Value *BinaryExprAST::codegenOperator(Value *L) {
   Value *R = RHS->codegen();
   if (!L || !R)
     return nullptr;
 
-  if (LHS->getCXType() != RHS->getCXType())
-    return LogErrorV("Binary operation on expressions of different types");
-
+  // Semantic analysis has made sure that both sides have the same type and
+  // that the operator is defined for it.
+  bool IsDouble = LHS->getCXType() == typ_double;
   switch (Op) {
   default:
     return LogErrorV("invalid binary operator");
   case '+':
-    setCXType(LHS->getCXType());
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateAdd(L, R, "addtmp");
-    case typ_bool:
-      return LogErrorV("operator '+' not defined for bool");
-    case typ_double:
-      return Builder->CreateFAdd(L, R, "addtmp");
-    }
+    return IsDouble ? Builder->CreateFAdd(L, R, "addtmp")
+                    : Builder->CreateAdd(L, R, "addtmp");
   case '-':
-    setCXType(LHS->getCXType());
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateSub(L, R, "subtmp");
-    case typ_bool:
-      return LogErrorV("operator '-' not defined for bool");
-    case typ_double:
-      return Builder->CreateFSub(L, R, "subtmp");
-    }
+    return IsDouble ? Builder->CreateFSub(L, R, "subtmp")
+                    : Builder->CreateSub(L, R, "subtmp");
   case '*':
-    setCXType(LHS->getCXType());
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateMul(L, R, "multmp");
-    case typ_bool:
-      return LogErrorV("operator '*' not defined for bool");
-    case typ_double:
-      return Builder->CreateFMul(L, R, "multmp");
-    }
+    return IsDouble ? Builder->CreateFMul(L, R, "multmp")
+                    : Builder->CreateMul(L, R, "multmp");
   case '/':
-    setCXType(LHS->getCXType());
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateUDiv(L, R, "divtmp");
-    case typ_bool:
-      return LogErrorV("operator '/' not defined for bool");
-    case typ_double:
-      return Builder->CreateFDiv(L, R, "divtmp");
-    }
+    return IsDouble ? Builder->CreateFDiv(L, R, "divtmp")
+                    : Builder->CreateUDiv(L, R, "divtmp");
   case '%':
-    setCXType(LHS->getCXType());
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateURem(L, R, "modtmp");
-    case typ_bool:
-      return LogErrorV("operator '%' not defined for bool");
-    case typ_double:
-      return LogErrorV("operator '%' not defined for double");
-    }
+    return Builder->CreateURem(L, R, "modtmp");
   case '<':
-    setCXType(typ_bool);
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateICmpULT(L, R, "cmptmp");
-    case typ_bool:
-      return LogErrorV("operator '<' not defined for bool");
-    case typ_double:
-      return Builder->CreateFCmpOLT(L, R, "cmptmp");
-    }
+    return IsDouble ? Builder->CreateFCmpOLT(L, R, "cmptmp")
+                    : Builder->CreateICmpULT(L, R, "cmptmp");
   case '>':
-    setCXType(typ_bool);
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateICmpUGT(L, R, "cmptmp");
-    case typ_bool:
-      return LogErrorV("operator '>' not defined for bool");
-    case typ_double:
-      return Builder->CreateFCmpOGT(L, R, "cmptmp");
-    }
+    return IsDouble ? Builder->CreateFCmpOGT(L, R, "cmptmp")
+                    : Builder->CreateICmpUGT(L, R, "cmptmp");
   case tok_eq:
-    setCXType(typ_bool);
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateICmpEQ(L, R, "cmptmp");
-    case typ_bool:
-      return Builder->CreateICmpEQ(L, R, "cmptmp");
-    case typ_double:
-      return Builder->CreateFCmpOEQ(L, R, "cmptmp");
-    }
+    return IsDouble ? Builder->CreateFCmpOEQ(L, R, "cmptmp")
+                    : Builder->CreateICmpEQ(L, R, "cmptmp");
   case tok_ne:
-    setCXType(typ_bool);
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateICmpNE(L, R, "cmptmp");
-    case typ_bool:
-      return Builder->CreateICmpNE(L, R, "cmptmp");
-    case typ_double:
-      return Builder->CreateFCmpONE(L, R, "cmptmp");
-    }
+    return IsDouble ? Builder->CreateFCmpONE(L, R, "cmptmp")
+                    : Builder->CreateICmpNE(L, R, "cmptmp");
   case tok_le:
-    setCXType(typ_bool);
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateICmpULE(L, R, "cmptmp");
-    case typ_bool:
-      return LogErrorV("operator '<=' not defined for bool");
-    case typ_double:
-      return Builder->CreateFCmpOLE(L, R, "cmptmp");
-    }
+    return IsDouble ? Builder->CreateFCmpOLE(L, R, "cmptmp")
+                    : Builder->CreateICmpULE(L, R, "cmptmp");
   case tok_ge:
-    setCXType(typ_bool);
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return Builder->CreateICmpUGE(L, R, "cmptmp");
-    case typ_bool:
-      return LogErrorV("operator '>=' not defined for bool");
-    case typ_double:
-      return Builder->CreateFCmpOGE(L, R, "cmptmp");
-    }
+    return IsDouble ? Builder->CreateFCmpOGE(L, R, "cmptmp")
+                    : Builder->CreateICmpUGE(L, R, "cmptmp");
   case tok_lor:
-    setCXType(typ_bool);
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return LogErrorV("operator '||' not defined for int");
-    case typ_bool:
-      return Builder->CreateLogicalOr(L, R, "lortmp");
-    case typ_double:
-      return LogErrorV("operator '||' not defined for double");
-    }
+    return Builder->CreateLogicalOr(L, R, "lortmp");
   case tok_land:
-    setCXType(typ_bool);
-    switch (LHS->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_int:
-      return LogErrorV("operator '&&' not defined for int");
-    case typ_bool:
-      return Builder->CreateLogicalAnd(L, R, "landtmp");
-    case typ_double:
-      return LogErrorV("operator '&&' not defined for double");
-    }
+    return Builder->CreateLogicalAnd(L, R, "landtmp");
   }
 }
 
 Value *CallExprAST::codegen() {
-  Function *CalleeF = TheModule->getFunction(Callee);
+  // A part module only declares the functions that are called from it.
+  Function *CalleeF = NamedFunctions.lookup(Callee);
   if (!CalleeF)
-    return LogErrorV("Unknown function referenced");
-
-  if (CalleeF->arg_size() != Args.size())
-    return LogErrorV("Incorrect # arguments passed");
+    CalleeF = Proto->codegen();
+  if (!CalleeF)
+    return nullptr;
 
   std::vector<Value *> ArgsV;
   for (unsigned i = 0, e = Args.size(); i != e; ++i) {
@@ -339,19 +223,12 @@ Value *CallExprAST::codegen() {
       return nullptr;
   }
 
-  if (CalleeF->getReturnType() == Type::getInt32Ty(*TheContext))
-    setCXType(typ_int);
-  if (CalleeF->getReturnType() == Type::getInt1Ty(*TheContext))
-    setCXType(typ_bool);
-  if (CalleeF->getReturnType() == Type::getDoubleTy(*TheContext))
-    setCXType(typ_double);
-
   return Builder->CreateCall(CalleeF, ArgsV, "calltmp");
 }
 
 AllocaInst *CreateEntryBlockAlloca(Function *TheFunction,
                                    const enum CXType VarType,
-                                   const std::string &VarName) {
+                                   const Twine &VarName) {
   IRBuilder<> TmpB(&TheFunction->getEntryBlock(),
                    TheFunction->getEntryBlock().begin());
 
@@ -369,15 +246,6 @@ AllocaInst *CreateEntryBlockAlloca(Function *TheFunction,
 }
 
 Function *PrototypeAST::codegen() {
-  auto Var = TheModule->getNamedGlobal(Name);
-  if (Var)
-    return (Function *)LogErrorV("Redeclaration of identifier");
-
-  Function *TheFunction = TheModule->getFunction(Name);
-
-  if (TheFunction)
-    return (Function *)LogErrorV("Redeclaration of identifier");
-
   std::vector<Type *> ArgsT;
   for (unsigned i = 0, e = Args.size(); i != e; ++i) {
     switch (Args[i]->getType()) {
@@ -410,56 +278,36 @@ Function *PrototypeAST::codegen() {
     return (Function *)LogErrorV("invalid return type");
   }
 
-  Function *F =
-      Function::Create(FT, Function::ExternalLinkage, Name, TheModule.get());
+  Function *F = Function::Create(FT, Function::ExternalLinkage,
+                                 getSymbolName(Name), TheModule.get());
 
   unsigned Idx = 0;
   for (auto &Arg : F->args())
-    Arg.setName(Args[Idx++]->getName());
+    Arg.setName(getSymbolName(Args[Idx++]->getName()));
 
+  NamedFunctions[Name] = F;
   return F;
 }
 
 Function *FunctionAST::codegen() {
-  auto Var = TheModule->getNamedGlobal(Proto->getName());
-  if (Var)
-    return (Function *)LogErrorV("Redefinition of identifier");
-
-  Function *TheFunction = TheModule->getFunction(Proto->getName());
-
-  if (!TheFunction) {
+  Function *TheFunction = NamedFunctions.lookup(Proto->getName());
+  if (!TheFunction)
     TheFunction = Proto->codegen();
-  } else if (!(*Proto == *NamedFns[Proto->getName()])) {
-    return (Function *)LogErrorV("Function has conflicting signatures");
-  }
-
   if (!TheFunction)
     return nullptr;
 
-  if (!TheFunction->empty())
-    return (Function *)LogErrorV("Function cannot be redefined.");
-
   BasicBlock *BB = BasicBlock::Create(*TheContext, "entry", TheFunction);
   Builder->SetInsertPoint(BB);
 
-  NamedValues.clear();
+  LocalValues.clear();
   unsigned Idx = 0;
   for (auto &Arg : TheFunction->args()) {
-    AllocaInst *Alloca = nullptr;
-
-    if (Arg.getType() == Type::getInt32Ty(*TheContext))
-      Alloca =
-          CreateEntryBlockAlloca(TheFunction, typ_int, Arg.getName().str());
-    if (Arg.getType() == Type::getInt1Ty(*TheContext))
-      Alloca =
-          CreateEntryBlockAlloca(TheFunction, typ_bool, Arg.getName().str());
-    if (Arg.getType() == Type::getDoubleTy(*TheContext))
-      Alloca =
-          CreateEntryBlockAlloca(TheFunction, typ_double, Arg.getName().str());
+    auto *Param = Proto->getArgs()[Idx++];
+    AllocaInst *Alloca = CreateEntryBlockAlloca(TheFunction, Param->getType(),
+                                                Arg.getName());
 
     Builder->CreateStore(&Arg, Alloca);
-    NamedValues[std::string(Arg.getName())] =
-        std::make_pair(Proto->getArgs()[Idx]->isConstVar(), Alloca);
+    LocalValues[Param] = Alloca;
   }
 
   if (Body->codegen()) {
@@ -490,13 +338,16 @@ Function *FunctionAST::codegen() {
       return (Function *)LogErrorV("Unreachable!");
     }
 
-    verifyFunction(*TheFunction);
-
-    NamedFns[Proto->getName()] = std::move(Proto);
+    {
+      TimeScope Scope(time_verify);
+      verifyFunction(*TheFunction);
+    }
+    RecordFunctionIR(*TheFunction, /*Optimized=*/false);
 
     return TheFunction;
   }
 
+  NamedFunctions.erase(Proto->getName());
   TheFunction->eraseFromParent();
   return nullptr;
 }
@@ -506,9 +357,6 @@ Value *IfStmtAST::codegen() {
   if (!CondV)
     return nullptr;
 
-  if (Cond->getCXType() != typ_bool)
-    return LogErrorV("Expected boolean expression in if");
-
   // CondV = Builder->CreateICmpNE(
   //     CondV, ConstantInt::get(*TheContext, APInt(1, 0)), "ifcond");
 
@@ -570,30 +418,8 @@ Value *IfStmtAST::codegen() {
 Value *ForStmtAST::codegen() {
   Function *TheFunction = Builder->GetInsertBlock()->getParent();
 
-  bool OldIsConst;
-  AllocaInst *OldAlloca = nullptr;
-
-  if (VarType != typ_err) {
-    AllocaInst *Alloca = CreateEntryBlockAlloca(TheFunction, VarType, VarName);
-
-    Value *StartVal = nullptr;
-
-    if (Start) {
-      StartVal = Start->codegen();
-      if (!StartVal)
-        return nullptr;
-      if (Start->getCXType() != VarType)
-        return LogErrorV(
-            "The loop variable was assigned a value of other type");
-
-      Builder->CreateStore(StartVal, Alloca);
-
-      OldIsConst = NamedValues[VarName].first;
-      OldAlloca = NamedValues[VarName].second;
-      NamedValues[VarName].first = false;
-      NamedValues[VarName].second = Alloca;
-    }
-  }
+  if (Var && !Var->codegen())
+    return nullptr;
 
   BasicBlock *CondBB = BasicBlock::Create(*TheContext, "cond", TheFunction);
   Builder->CreateBr(CondBB);
@@ -604,8 +430,6 @@ Value *ForStmtAST::codegen() {
     EndCond = End->codegen();
     if (!EndCond)
       return nullptr;
-    if (End->getCXType() != typ_bool)
-      return LogErrorV("Expected boolean expression in for");
   } else
     EndCond =
         Constant::getIntegerValue(Type::getInt1Ty(*TheContext), APInt(1, 1));
@@ -640,11 +464,6 @@ Value *ForStmtAST::codegen() {
   TheFunction->insert(TheFunction->end(), AfterBB);
   Builder->SetInsertPoint(AfterBB);
 
-  if (OldAlloca)
-    NamedValues[VarName] = std::make_pair(OldIsConst, OldAlloca);
-  else
-    NamedValues.erase(VarName);
-
   ContDest = OldContDest;
   BrkDest = OldBrkDest;
 
@@ -661,17 +480,10 @@ Value *UnaryExprAST::codegen() {
   default:
     return LogErrorV("Invalid unary operator");
 
-  case '!': {
-    if (Operand->getCXType() != typ_bool)
-      return LogErrorV("Expected boolean expression after '!'");
-    setCXType(typ_bool);
+  case '!':
     return Builder->CreateNot(V, "nottmp");
-  }
 
   case tok_ODD: {
-    if (Operand->getCXType() != typ_int)
-      return LogErrorV("Expected int expression after 'ODD'");
-    setCXType(typ_bool);
     auto AndTmp = Builder->CreateAnd(
         V,
         Constant::getIntegerValue(Type::getInt32Ty(*TheContext), APInt(32, 1)),
@@ -682,89 +494,23 @@ Value *UnaryExprAST::codegen() {
         "andtmp");
   }
 
-  case tok_increment: {
-    auto OpVar = std::unique_ptr<VariableExprAST>(
-        dynamic_cast<VariableExprAST *>(Operand.release()));
-    if (!OpVar)
-      return LogErrorV("Operand of '++' must be a variable");
-
-    Value *Dest = NamedValues[OpVar->getName()].second;
-    if (!Dest) {
-      auto G = TheModule->getNamedGlobal(OpVar->getName());
-      if (!G)
-        return LogErrorV("Unknown variable");
-      Dest = G;
-    }
-
-    if (NamedValues[OpVar->getName()].first)
-      return LogErrorV("Const variables cannot perform self increment");
-
-    switch (OpVar->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_bool:
-      return LogErrorV("operator ++ is not defined for bool");
-    case typ_int: {
-      setCXType(typ_int);
-      auto AddTmp =
-          Builder->CreateAdd(V,
-                             Constant::getIntegerValue(
-                                 Type::getInt32Ty(*TheContext), APInt(32, 1)),
-                             "addtmp");
-      Builder->CreateStore(AddTmp, Dest);
-      return AddTmp;
-    }
-
-    case typ_double: {
-      setCXType(typ_double);
-      auto AddTmp = Builder->CreateFAdd(
-          V, ConstantFP::get(*TheContext, APFloat(1.0)), "addtmp");
-      Builder->CreateStore(AddTmp, Dest);
-      return AddTmp;
-    }
-    }
-  }
-
+  case tok_increment:
   case tok_decrement: {
-    auto OpVar = std::unique_ptr<VariableExprAST>(
-        dynamic_cast<VariableExprAST *>(Operand.release()));
-    if (!OpVar)
-      return LogErrorV("Operand of '--' must be a variable");
-
-    Value *Dest = NamedValues[OpVar->getName()].second;
-    if (!Dest) {
-      auto G = TheModule->getNamedGlobal(OpVar->getName());
-      if (!G)
-        return LogErrorV("Unknown variable");
-      Dest = G;
-    }
-
-    if (NamedValues[OpVar->getName()].first)
-      return LogErrorV("Const variables cannot perform self increment");
-
-    switch (OpVar->getCXType()) {
-    default:
-      return LogErrorV("Unreachable!");
-    case typ_bool:
-      return LogErrorV("operator -- is not defined for bool");
-    case typ_int: {
-      setCXType(typ_int);
-      auto SubTmp =
-          Builder->CreateSub(V,
-                             Constant::getIntegerValue(
-                                 Type::getInt32Ty(*TheContext), APInt(32, 1)),
-                             "subtmp");
-      Builder->CreateStore(SubTmp, Dest);
-      return SubTmp;
-    }
-    case typ_double: {
-      setCXType(typ_double);
-      auto SubTmp = Builder->CreateFSub(
-          V, ConstantFP::get(*TheContext, APFloat(1.0)), "subtmp");
-      Builder->CreateStore(SubTmp, Dest);
-      return SubTmp;
-    }
-    }
+    bool Inc = Opcode == tok_increment;
+    Value *NewV = nullptr;
+    if (getCXType() == typ_double) {
+      auto One = ConstantFP::get(*TheContext, APFloat(1.0));
+      NewV = Inc ? Builder->CreateFAdd(V, One, "addtmp")
+                 : Builder->CreateFSub(V, One, "subtmp");
+    } else {
+      auto One = Constant::getIntegerValue(Type::getInt32Ty(*TheContext),
+                                           APInt(32, 1));
+      NewV = Inc ? Builder->CreateAdd(V, One, "addtmp")
+                 : Builder->CreateSub(V, One, "subtmp");
+    }
+    Builder->CreateStore(NewV,
+                         getVariableAddress(cast<VariableExprAST>(Operand)));
+    return NewV;
   }
   }
 }
@@ -776,92 +522,44 @@ Value *ExprStmtAST::codegen() {
 }
 
 Value *BlockStmtAST::codegen() {
-  // Backup.
-  auto OldNamedValues = NamedValues;
-  auto OldTakenNames = TakenNames;
-  TakenNames.clear();
-
-  for (auto &Elem : Elems) {
-    auto VarDecl = dynamic_cast<VarDeclAST *>(Elem.get());
-    if (VarDecl && !VarDecl->codegen())
-      return nullptr;
-
-    auto Stmt = dynamic_cast<StmtAST *>(Elem.get());
-    if (Stmt && !Stmt->codegen())
+  for (auto *Elem : Elems) {
+    if (auto VarDecl = dyn_cast<VarDeclAST>(Elem)) {
+      if (!VarDecl->codegen())
+        return nullptr;
+    } else if (!cast<StmtAST>(Elem)->codegen()) {
       return nullptr;
+    }
   }
 
-  // Recover.
-  TakenNames = OldTakenNames;
-  NamedValues = OldNamedValues;
   return Constant::getNullValue(Type::getVoidTy(*TheContext));
 }
 
 Function *VarDeclAST::codegen() {
-  if (TakenNames.find(Name) != TakenNames.end())
-    return (Function *)LogErrorV("The name has been taken in the same scope");
-
   auto TheFunction = Builder->GetInsertBlock()->getParent();
-  auto Alloca = CreateEntryBlockAlloca(TheFunction, Type, Name);
+  auto Alloca = CreateEntryBlockAlloca(TheFunction, Type, getSymbolName(Name));
 
   if (Val) {
     auto V = Val->codegen();
     if (!V)
       return nullptr;
-    if (Val->getCXType() != Type)
-      return (Function *)LogErrorV("Incompatible types.");
     Builder->CreateStore(V, Alloca);
   }
 
-  TakenNames.insert(Name);
-  NamedValues[Name] = std::make_pair(isConst, Alloca);
+  LocalValues[this] = Alloca;
   return (Function *)Constant::getNullValue(Type::getVoidTy(*TheContext));
 }
 
 Function *GlobVarDeclAST::codegen() {
-  auto Var = TheModule->getNamedGlobal(Name);
-  if (Var)
-    return (Function *)LogErrorV("Redefinition of identifier");
-
-  auto Fn = TheModule->getFunction(Name);
-  if (Fn)
-    return (Function *)LogErrorV("Redefinition of identifier");
-
-  Value *V = nullptr;
+  Constant *Init = Constant::getNullValue(llvmTypeFromCXType(Type));
   if (Val) {
-    switch (Type) {
-    case typ_err:
-      return (Function *)LogErrorV("Unreachable!");
-    case typ_int: {
-      if (!dynamic_cast<IntExprAST *>(Val.get()))
-        return (Function *)LogErrorV(
-            "Expected initial value to be int constant");
-      break;
-    }
-    case typ_bool: {
-      if (!dynamic_cast<BooleanExprAST *>(Val.get()))
-        return (Function *)LogErrorV(
-            "Expected initial value to be bool constant");
-      break;
-    }
-    case typ_double: {
-      if (!dynamic_cast<DoubleExprAST *>(Val.get()))
-        return (Function *)LogErrorV(
-            "Expected initial value to be double constant");
-      break;
-    }
-    }
-    V = Val->codegen();
-    if (!V)
-      return (Function *)LogErrorV("Expected initial value");
+    // Semantic analysis only accepts literals here.
+    Init = cast<Constant>(Val->codegen());
   }
 
-  Var = new GlobalVariable(*TheModule, llvmTypeFromCXType(Type), isConst,
-                           GlobalValue::ExternalLinkage,
-                           Constant::getNullValue(llvmTypeFromCXType(Type)),
-                           Name);
-  if (V)
-    Var->setInitializer((Constant *)V);
+  auto Var = new GlobalVariable(*TheModule, llvmTypeFromCXType(Type), isConst,
+                                GlobalValue::ExternalLinkage, Init,
+                                getSymbolName(Name));
+  NamedGlobals[Name] = Var;
   return (Function *)Constant::getNullValue(Type::getVoidTy(*TheContext));
 }
 
@@ -872,75 +570,53 @@ Value *SwitchStmtAST::codegen() {
   if (!V)
     return nullptr;
 
-  auto ExprType = Expr->getCXType();
-  if (ExprType == typ_double)
-    return LogErrorV("Expected integer types in switch");
-
-  auto CondBB = BasicBlock::Create(*TheContext, "cond", TheFunction);
-  auto HandleBB = BasicBlock::Create(*TheContext, "handle");
-  auto AfterBB = BasicBlock::Create(*TheContext, "afterswitch", TheFunction);
-  Builder->CreateBr(CondBB);
-
-  auto OldBrkDest = BrkDest;
-  BrkDest = AfterBB;
-
+  // Fold every label to a constant before emitting the dispatch, so that a
+  // single switch instruction covers all of them.
+  SmallVector<BasicBlock *, 16> HandleBBs;
+  SmallVector<std::pair<ConstantInt *, BasicBlock *>, 16> Cases;
   BasicBlock *DefaultBB = nullptr;
   for (auto &Item : BasicBlocks) {
-    auto &CondList = Item.first;
-    auto &Handle = Item.second;
+    auto HandleBB = BasicBlock::Create(*TheContext, "handle");
+    HandleBBs.push_back(HandleBB);
 
-    for (auto &Cond : CondList) {
+    for (auto *Cond : Item.Labels) {
       if (!Cond) { // the "default" case
         DefaultBB = HandleBB;
         continue;
       }
 
-      TheFunction->insert(TheFunction->end(), CondBB);
-      Builder->SetInsertPoint(CondBB);
-
       auto CondV = Cond->codegen();
       if (!CondV)
         return nullptr;
 
-      if (Cond->getCXType() != ExprType)
-        return LogErrorV("Expected same type in switch-case");
+      // Sema has checked that labels are distinct constant expressions, and
+      // IRBuilder folds those to a ConstantInt.
+      Cases.push_back(std::make_pair(cast<ConstantInt>(CondV), HandleBB));
+    }
+  }
 
-      switch (ExprType) {
-      case typ_err:
-      case typ_double:
-        return LogErrorV("Unreachable!");
-      case typ_int:
-      case typ_bool:
-        CondV = Builder->CreateICmpEQ(V, CondV, "cmptmp");
-      }
+  auto AfterBB = BasicBlock::Create(*TheContext, "afterswitch");
+  auto SI = Builder->CreateSwitch(V, DefaultBB ? DefaultBB : AfterBB,
+                                  Cases.size());
+  for (auto &Case : Cases)
+    SI->addCase(Case.first, Case.second);
 
-      CondBB = BasicBlock::Create(*TheContext, "cond");
-      Builder->CreateCondBr(CondV, HandleBB, CondBB);
-    }
+  auto OldBrkDest = BrkDest;
+  BrkDest = AfterBB;
 
+  // Arms are laid out in order, and each one falls through to the next.
+  for (unsigned i = 0, e = HandleBBs.size(); i != e; ++i) {
+    auto HandleBB = HandleBBs[i];
     TheFunction->insert(TheFunction->end(), HandleBB);
     Builder->SetInsertPoint(HandleBB);
-    for (auto &Stmt : Handle) {
+    for (auto *Stmt : BasicBlocks[i].Stmts) {
       auto *S = Stmt->codegen();
       if (!S)
         return nullptr;
     }
-    HandleBB = BasicBlock::Create(*TheContext, "handle");
-    Builder->CreateBr(HandleBB);
+    Builder->CreateBr(i + 1 != e ? HandleBBs[i + 1] : AfterBB);
   }
 
-  TheFunction->insert(TheFunction->end(), CondBB);
-  Builder->SetInsertPoint(CondBB);
-
-  if (DefaultBB)
-    Builder->CreateBr(DefaultBB);
-  else
-    Builder->CreateBr(AfterBB);
-
-  TheFunction->insert(TheFunction->end(), HandleBB);
-  Builder->SetInsertPoint(HandleBB);
-  Builder->CreateBr(AfterBB);
-
   TheFunction->insert(TheFunction->end(), AfterBB);
   Builder->SetInsertPoint(AfterBB);
 
@@ -1013,7 +689,7 @@ Value *DoStmtAST::codegen() {
 
   Builder->CreateCondBr(CondV, LoopBB, AfterBB);
 
-  TheFunction->insert(TheFunction->end(), CondBB);
+  TheFunction->insert(TheFunction->end(), AfterBB);
   Builder->SetInsertPoint(AfterBB);
 
   ContDest = OldContDest;
@@ -1052,7 +728,7 @@ Value *UntilStmtAST::codegen() {
 
   Builder->CreateCondBr(CondV, LoopBB, AfterBB);
 
-  TheFunction->insert(TheFunction->end(), CondBB);
+  TheFunction->insert(TheFunction->end(), AfterBB);
   Builder->SetInsertPoint(AfterBB);
 
   ContDest = OldContDest;
@@ -1062,55 +738,25 @@ Value *UntilStmtAST::codegen() {
 }
 
 Value *ReadStmtAST::codegen() {
-  auto Var = dynamic_cast<VariableExprAST *>(this->Var.get());
-  if (!Var)
-    return LogErrorV("Can only read to a variable");
-
-  AllocaInst *A = NamedValues[Var->getName()].second;
-  if (!A) {
-    auto *G = TheModule->getNamedGlobal(Var->getName());
-    if (!G)
-      return LogErrorV("Unknown variable name");
-
-    if (G->isConstant())
-      return LogErrorV("Can't assign to const variables");
+  auto Var = cast<VariableExprAST>(this->Var);
 
-    auto CalleeF = TheModule->getFunction("scanf");
-    Value *fmt = nullptr;
-
-    if (G->getValueType() == Type::getInt32Ty(*TheContext)) {
-      fmt = TheModule->getNamedGlobal("infmt_int");
-    }
-    if (G->getValueType() == Type::getInt1Ty(*TheContext)) {
-      fmt = TheModule->getNamedGlobal("infmt_int");
-    }
-    if (G->getValueType() == Type::getDoubleTy(*TheContext)) {
-      fmt = TheModule->getNamedGlobal("infmt_double");
-    }
-
-    Value *Args[] = {fmt, G};
-    Builder->CreateCall(CalleeF, Args, "calltmp");
-    return (Function *)Constant::getNullValue(Type::getVoidTy(*TheContext));
-  }
-
-  if (NamedValues[Var->getName()].first)
-    LogErrorV("Cannot read to a const variable");
-
-  auto CalleeF = TheModule->getFunction("scanf");
-  Value *fmt = nullptr;
-
-  if (A->getAllocatedType() == Type::getInt32Ty(*TheContext)) {
-    fmt = TheModule->getNamedGlobal("infmt_int");
-  }
-  if (A->getAllocatedType() == Type::getInt1Ty(*TheContext)) {
-    fmt = TheModule->getNamedGlobal("infmt_int");
-  }
-  if (A->getAllocatedType() == Type::getDoubleTy(*TheContext)) {
-    fmt = TheModule->getNamedGlobal("infmt_double");
+  Function *CalleeF = nullptr;
+  switch (Var->getCXType()) {
+  case typ_err:
+    return LogErrorV("Unreachable!");
+  case typ_int:
+    CalleeF = TheModule->getFunction("cx_read_i32");
+    break;
+  case typ_bool:
+    CalleeF = TheModule->getFunction("cx_read_bool");
+    break;
+  case typ_double:
+    CalleeF = TheModule->getFunction("cx_read_f64");
+    break;
   }
 
-  Value *Args[] = {fmt, A};
-  Builder->CreateCall(CalleeF, Args, "calltmp");
+  Builder->CreateStore(Builder->CreateCall(CalleeF, None, "readtmp"),
+                       getVariableAddress(Var));
   return (Function *)Constant::getNullValue(Type::getVoidTy(*TheContext));
 }
 
@@ -1119,51 +765,56 @@ Value *WriteStmtAST::codegen() {
   if (!V)
     return nullptr;
 
-  auto CalleeF = TheModule->getFunction("printf");
-  Value *fmt = nullptr;
+  Function *CalleeF = nullptr;
 
   switch (Val->getCXType()) {
   case typ_err:
     return LogErrorV("Unreachable!");
-  case typ_int:
   case typ_bool:
-    fmt = TheModule->getNamedGlobal("outfmt_int");
+    V = Builder->CreateZExt(V, Builder->getInt32Ty(), "booltmp");
+    CalleeF = TheModule->getFunction("cx_write_i32");
+    break;
+  case typ_int:
+    CalleeF = TheModule->getFunction("cx_write_i32");
     break;
   case typ_double:
-    fmt = TheModule->getNamedGlobal("outfmt_double");
+    CalleeF = TheModule->getFunction("cx_write_f64");
     break;
   }
 
-  Value *Args[] = {fmt, V};
-  Builder->CreateCall(CalleeF, Args, "calltmp");
+  Builder->CreateCall(CalleeF, V);
   return (Function *)Constant::getNullValue(Type::getVoidTy(*TheContext));
 }
 
+/**
+ * Code following `continue`, `break` or `return` is unreachable, but it still
+ * has to live in a basic block of its own, since nothing may follow a
+ * terminator in the same block.
+ */
+static void StartUnreachableBlock(const char *Name) {
+  auto TheFunction = Builder->GetInsertBlock()->getParent();
+  Builder->SetInsertPoint(BasicBlock::Create(*TheContext, Name, TheFunction));
+}
+
 Value *ContStmtAST::codegen() {
-  if (!ContDest)
-    return LogErrorV("Cannot use 'continue' here");
   Builder->CreateBr(ContDest);
+  StartUnreachableBlock("aftercont");
   return (Function *)Constant::getNullValue(Type::getVoidTy(*TheContext));
 }
 
 Value *BrkStmtAST::codegen() {
-  if (!BrkDest)
-    return LogErrorV("Cannot use 'break' here");
   Builder->CreateBr(BrkDest);
+  StartUnreachableBlock("afterbrk");
   return (Function *)Constant::getNullValue(Type::getVoidTy(*TheContext));
 }
 
 Value *RetStmtAST::codegen() {
-  auto TheFunction = Builder->GetInsertBlock()->getParent();
-
   auto V = Val->codegen();
   if (!V)
     return nullptr;
 
-  if (TheFunction->getReturnType() != V->getType())
-    return LogErrorV("Incompatable return type");
-
   Builder->CreateRet(V);
+  StartUnreachableBlock("afterret");
   return (Function *)Constant::getNullValue(Type::getVoidTy(*TheContext));
 }
 
@@ -1241,8 +892,6 @@ Value *CastExprAST::codegen() {
   } break;
   }
 
-  if (V)
-    setCXType(Type);
   return V;
 }
 
@@ -0,0 +1,52 @@
+#include "jit.h"
+#include "cxrt.h"
+#include "emit.h"
+#include <cstdio>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/TargetSelect.h>
+
+using namespace llvm::orc;
+
+static int LogErrorJIT(Error Err) {
+  fprintf(stderr, "Error: %s\n", toString(std::move(Err)).c_str());
+  return 1;
+}
+
+int RunModule(std::unique_ptr<Module> M, std::unique_ptr<LLVMContext> Ctx,
+              unsigned OptLevel, int &Ret) {
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+
+  auto JTMB = JITTargetMachineBuilder::detectHost();
+  if (!JTMB)
+    return LogErrorJIT(JTMB.takeError());
+  JTMB->setCodeGenOptLevel(getCodeGenOptLevel(OptLevel));
+
+  auto J = LLJITBuilder().setJITTargetMachineBuilder(std::move(*JTMB)).create();
+  if (!J)
+    return LogErrorJIT(J.takeError());
+
+  auto Generator = DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      (*J)->getDataLayout().getGlobalPrefix());
+  if (!Generator)
+    return LogErrorJIT(Generator.takeError());
+  (*J)->getMainJITDylib().addGenerator(std::move(*Generator));
+
+  if (auto Err =
+          (*J)->addIRModule(ThreadSafeModule(std::move(M), std::move(Ctx))))
+    return LogErrorJIT(std::move(Err));
+
+  auto MainSym = (*J)->lookup("main");
+  if (!MainSym)
+    return LogErrorJIT(MainSym.takeError());
+
+  auto *Main = MainSym->toPtr<int (*)()>();
+  Ret = Main();
+  cx_flush();
+  fflush(stdout);
+  return 0;
+}
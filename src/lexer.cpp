@@ -1,156 +1,284 @@
 #include "lexer.h"
 #include <cctype>
 #include <cstdio>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <llvm/Support/ErrorOr.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <memory>
 #include <string>
 
-std::string IdentifierStr;
-double NumVal;
-unsigned NR = 1;
+thread_local llvm::StringRef IdentifierStr;
+thread_local double NumVal;
+thread_local uint64_t IntVal;
+thread_local unsigned NR = 1;
+thread_local size_t TokOffset = 0;
+thread_local size_t TokLength = 0;
 
-/// gettok - Return the next token from standard input.
-int gettok() {
-  static int LastChar = ' ';
+/// The whole source file. It is always null-terminated.
+static thread_local std::unique_ptr<llvm::MemoryBuffer> Source;
+/// Bounds of the source, the next character to be scanned and the first
+/// character of the current token.
+static thread_local const char *BufferStart = "";
+static thread_local const char *BufferEnd = "";
+static thread_local const char *CurPtr = "";
+static thread_local const char *TokStart = "";
 
-  // Skip whitespaces.
-  while (isspace(LastChar)) {
-    if (LastChar == '\n')
-      ++NR;
-    LastChar = getchar();
+int OpenSource(const std::string &FileName) {
+  auto BufferOrErr = llvm::MemoryBuffer::getFileOrSTDIN(FileName);
+  if (!BufferOrErr) {
+    fprintf(stderr, "Error: cannot read '%s': %s\n", FileName.c_str(),
+            BufferOrErr.getError().message().c_str());
+    return 1;
   }
 
-  // Identifiers.
-  if (isalpha(LastChar)) {
-    IdentifierStr = LastChar;
-    while (isalnum((LastChar = getchar())))
-      IdentifierStr += LastChar;
-
-    // if (IdentifierStr == "def")
-    //   return tok_def;
-    if (IdentifierStr == "cast")
-      return tok_cast;
-    if (IdentifierStr == "true")
-      return tok_true;
-    if (IdentifierStr == "false")
-      return tok_false;
-    if (IdentifierStr == "if")
-      return tok_if;
-    if (IdentifierStr == "else")
-      return tok_else;
-    if (IdentifierStr == "switch")
-      return tok_switch;
-    if (IdentifierStr == "default")
-      return tok_default;
-    if (IdentifierStr == "case")
-      return tok_case;
-    if (IdentifierStr == "while")
-      return tok_while;
-    if (IdentifierStr == "do")
-      return tok_do;
-    if (IdentifierStr == "for")
-      return tok_for;
-    if (IdentifierStr == "repeat")
-      return tok_repeat;
-    if (IdentifierStr == "until")
-      return tok_until;
-    if (IdentifierStr == "write")
-      return tok_write;
-    if (IdentifierStr == "read")
-      return tok_read;
-    if (IdentifierStr == "continue")
-      return tok_continue;
-    if (IdentifierStr == "break")
-      return tok_break;
-    if (IdentifierStr == "return")
-      return tok_return;
-    if (IdentifierStr == "exit")
-      return tok_exit;
-    if (IdentifierStr == "int")
-      return tok_int;
-    if (IdentifierStr == "bool")
-      return tok_bool;
-    if (IdentifierStr == "double")
-      return tok_double;
-    if (IdentifierStr == "const")
-      return tok_const;
-    if (IdentifierStr == "ODD")
-      return tok_ODD;
-    return tok_identifier;
+  Source = std::move(*BufferOrErr);
+  BufferStart = Source->getBufferStart();
+  BufferEnd = Source->getBufferEnd();
+  RewindSource();
+  return 0;
+}
+
+void RewindSource() {
+  CurPtr = TokStart = BufferStart;
+  NR = 1;
+  TokOffset = TokLength = 0;
+}
+
+SourcePosition getTokenPosition() { return {TokOffset, NR}; }
+
+void SeekSource(SourcePosition Pos) {
+  CurPtr = TokStart = BufferStart + Pos.Offset;
+  NR = Pos.Line;
+}
+
+static inline bool isSpace(char C) {
+  return C == ' ' || C == '\n' || C == '\t' || C == '\r' || C == '\v' ||
+         C == '\f';
+}
+
+static inline bool isDigit(char C) { return C >= '0' && C <= '9'; }
+
+static inline bool isAlpha(char C) {
+  return (C >= 'a' && C <= 'z') || (C >= 'A' && C <= 'Z');
+}
+
+static inline bool isAlnum(char C) { return isAlpha(C) || isDigit(C); }
+
+/// Classify an identifier by its length and first characters, so that at
+/// most one string comparison is made per identifier.
+static int getKeywordToken(const char *S, size_t Len) {
+  auto Match = [&](const char *Keyword, int Tok) {
+    return memcmp(S, Keyword, Len) == 0 ? Tok : tok_identifier;
+  };
+
+  switch (Len) {
+  case 2:
+    switch (S[0]) {
+    case 'i':
+      return Match("if", tok_if);
+    case 'd':
+      return Match("do", tok_do);
+    }
+    break;
+  case 3:
+    switch (S[0]) {
+    case 'f':
+      return Match("for", tok_for);
+    case 'i':
+      return Match("int", tok_int);
+    case 'O':
+      return Match("ODD", tok_ODD);
+    }
+    break;
+  case 4:
+    switch (S[0]) {
+    case 'c':
+      return S[3] == 't' ? Match("cast", tok_cast) : Match("case", tok_case);
+    case 't':
+      return Match("true", tok_true);
+    case 'e':
+      return S[1] == 'l' ? Match("else", tok_else) : Match("exit", tok_exit);
+    case 'r':
+      return Match("read", tok_read);
+    case 'b':
+      return Match("bool", tok_bool);
+    }
+    break;
+  case 5:
+    switch (S[0]) {
+    case 'f':
+      return Match("false", tok_false);
+    case 'w':
+      return S[1] == 'h' ? Match("while", tok_while)
+                         : Match("write", tok_write);
+    case 'u':
+      return Match("until", tok_until);
+    case 'b':
+      return Match("break", tok_break);
+    case 'c':
+      return Match("const", tok_const);
+    }
+    break;
+  case 6:
+    switch (S[0]) {
+    case 's':
+      return Match("switch", tok_switch);
+    case 'r':
+      return S[2] == 'p' ? Match("repeat", tok_repeat)
+                         : Match("return", tok_return);
+    case 'd':
+      return Match("double", tok_double);
+    }
+    break;
+  case 7:
+    return Match("default", tok_default);
+  case 8:
+    return Match("continue", tok_continue);
   }
+  return tok_identifier;
+}
 
-  // Numbers.
-  if (isdigit(LastChar) || LastChar == '.') {
-    bool isDouble = false;
-    std::string NumStr;
-    do {
-      if (LastChar == '.') {
-        if (isDouble)
-          return tok_doubleliteral;
-        isDouble = true;
-      }
-      NumStr += LastChar;
-      LastChar = getchar();
-    } while (isdigit(LastChar) || LastChar == '.');
-
-    NumVal = strtod(NumStr.c_str(), 0);
-
-    if (isDouble)
-      return tok_doubleliteral;
+/// Powers of ten that are exactly representable as doubles.
+static const double ExactPowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/// Scan an integer or double literal in place. Integer literals are
+/// accumulated exactly, modulo 2^64. Double literals with at most 15
+/// significant digits are converted with a single correctly rounded
+/// division, and the rest fall back to strtod on a stack copy.
+static int lexNumber() {
+  uint64_t Mantissa = 0;
+  unsigned Digits = 0;
+  unsigned FracDigits = 0;
+  bool isDouble = false;
+
+  do {
+    if (*CurPtr == '.') {
+      // A second '.' ends the literal.
+      if (isDouble)
+        break;
+      isDouble = true;
+    } else {
+      Mantissa = Mantissa * 10 + (*CurPtr - '0');
+      if (Mantissa || Digits)
+        ++Digits;
+      if (isDouble)
+        ++FracDigits;
+    }
+    ++CurPtr;
+  } while (isDigit(*CurPtr) || *CurPtr == '.');
+
+  if (!isDouble) {
+    IntVal = Mantissa;
     return tok_intliteral;
   }
 
-  if (LastChar == EOF)
+  if (Digits <= 15 && FracDigits <= 22) {
+    NumVal = (double)Mantissa / ExactPowersOfTen[FracDigits];
+    return tok_doubleliteral;
+  }
+
+  char Buf[128];
+  size_t Len = CurPtr - TokStart;
+  if (Len < sizeof(Buf)) {
+    memcpy(Buf, TokStart, Len);
+    Buf[Len] = '\0';
+    NumVal = strtod(Buf, nullptr);
+  } else {
+    NumVal = strtod(std::string(TokStart, CurPtr).c_str(), nullptr);
+  }
+  return tok_doubleliteral;
+}
+
+static int lexToken();
+
+/// gettok - Return the next token from the source.
+int gettok() {
+  int Tok = lexToken();
+  TokOffset = TokStart - BufferStart;
+  TokLength = CurPtr - TokStart;
+  return Tok;
+}
+
+static int lexToken() {
+  // Skip whitespaces and comments.
+  while (true) {
+    while (CurPtr != BufferEnd && isSpace(*CurPtr)) {
+      if (*CurPtr == '\n')
+        ++NR;
+      ++CurPtr;
+    }
+
+    if (CurPtr == BufferEnd || CurPtr[0] != '/' || CurPtr[1] != '*')
+      break;
+
+    const char *End = CurPtr + 2;
+    while (End != BufferEnd && !(End[0] == '*' && End[1] == '/')) {
+      if (*End == '\n')
+        ++NR;
+      ++End;
+    }
+    CurPtr = End == BufferEnd ? End : End + 2;
+  }
+
+  TokStart = CurPtr;
+  if (CurPtr == BufferEnd)
     return tok_eof;
 
-  int ThisChar = LastChar;
-  LastChar = getchar();
+  // Identifiers.
+  if (isAlpha(*CurPtr)) {
+    while (isAlnum(*++CurPtr))
+      ;
+
+    int Tok = getKeywordToken(TokStart, CurPtr - TokStart);
+    if (Tok == tok_identifier)
+      IdentifierStr = llvm::StringRef(TokStart, CurPtr - TokStart);
+    return Tok;
+  }
+
+  // Numbers.
+  if (isDigit(*CurPtr) || *CurPtr == '.')
+    return lexNumber();
+
+  int ThisChar = (unsigned char)*CurPtr++;
+  char NextChar = *CurPtr;
 
   // Multi-char operators
-  if (ThisChar == '<' && LastChar == '=') {
-    LastChar = getchar();
+  if (ThisChar == '<' && NextChar == '=') {
+    ++CurPtr;
     return tok_le;
   }
-  if (ThisChar == '>' && LastChar == '=') {
-    LastChar = getchar();
+  if (ThisChar == '>' && NextChar == '=') {
+    ++CurPtr;
     return tok_ge;
   }
-  if (ThisChar == '=' && LastChar == '=') {
-    LastChar = getchar();
+  if (ThisChar == '=' && NextChar == '=') {
+    ++CurPtr;
     return tok_eq;
   }
-  if (ThisChar == '!' && LastChar == '=') {
-    LastChar = getchar();
+  if (ThisChar == '!' && NextChar == '=') {
+    ++CurPtr;
     return tok_ne;
   }
-  if (ThisChar == '|' && LastChar == '|') {
-    LastChar = getchar();
+  if (ThisChar == '|' && NextChar == '|') {
+    ++CurPtr;
     return tok_lor;
   }
-  if (ThisChar == '&' && LastChar == '&') {
-    LastChar = getchar();
+  if (ThisChar == '&' && NextChar == '&') {
+    ++CurPtr;
     return tok_land;
   }
-  if (ThisChar == '+' && LastChar == '+') {
-    LastChar = getchar();
+  if (ThisChar == '+' && NextChar == '+') {
+    ++CurPtr;
     return tok_increment;
   }
-  if (ThisChar == '-' && LastChar == '-') {
-    LastChar = getchar();
+  if (ThisChar == '-' && NextChar == '-') {
+    ++CurPtr;
     return tok_decrement;
   }
 
-  // Comments.
-  if (ThisChar == '/' && LastChar == '*') {
-    do {
-      ThisChar = LastChar;
-      LastChar = getchar();
-    } while (LastChar != EOF && !(ThisChar == '*' && LastChar == '/'));
-
-    if (LastChar != EOF) {
-      LastChar = getchar();
-      return gettok();
-    }
-  }
-
   return ThisChar;
 }
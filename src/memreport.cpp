@@ -0,0 +1,335 @@
+#include "memreport.h"
+#include "ir.h"
+#include "sema.h"
+#include "symbol.h"
+#include <algorithm>
+#include <cstdio>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include <mutex>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+bool MemReportEnabled = false;
+
+namespace {
+/**
+ * @brief Allocations of a class of AST nodes.
+ */
+struct ClassMemory {
+  size_t Nodes = 0;
+  size_t Bytes = 0;
+};
+
+/**
+ * @brief What a function takes, summed over its declarations.
+ */
+struct FunctionMemory {
+  size_t ASTNodes = 0;
+  size_t ASTBytes = 0;
+  /**
+   * @brief Basic blocks and instructions as generated.
+   */
+  size_t Blocks = 0, Instructions = 0;
+  /**
+   * @brief Basic blocks and instructions after optimizing.
+   */
+  size_t OptBlocks = 0, OptInstructions = 0;
+  /**
+   * @brief Growth of the peak resident set while it was compiled, in KiB.
+   */
+  long RSSGrowth = 0;
+};
+
+/**
+ * @brief Largest size a symbol table was seen at.
+ */
+struct TableSize {
+  size_t Entries = 0;
+  size_t Bytes = 0;
+};
+
+using FunctionEntry = std::pair<std::string, FunctionMemory>;
+} // namespace
+
+/// Symbol tables, in the order of `TableNames`.
+enum {
+  table_local_decls = 0,
+  table_global_decls,
+  table_function_decls,
+  table_defined_functions,
+  table_local_values,
+  table_named_globals,
+  table_named_functions,
+  num_tables
+};
+
+static const char *TableNames[num_tables] = {
+    "LocalDecls",   "GlobalDecls",  "FunctionDecls", "DefinedFunctions",
+    "LocalValues",  "NamedGlobals", "NamedFunctions"};
+
+/// Nodes the calling thread has not charged to a declaration yet, by class.
+static thread_local SmallVector<ClassMemory, 32> CurrentNodes;
+
+static std::mutex MemoryLock;
+static std::vector<std::string> ClassNames;
+static std::vector<ClassMemory> Classes;
+/// Functions in the order they are first recorded in.
+static std::vector<FunctionEntry> Functions;
+static StringMap<unsigned> FunctionIndex;
+static TableSize Tables[num_tables];
+static std::vector<std::pair<std::string, long>> Phases;
+static long LastPeakRSS = 0;
+
+/// Get the peak resident set of the process so far, in KiB.
+static long getPeakRSS() {
+  rusage Usage;
+  if (getrusage(RUSAGE_SELF, &Usage))
+    return 0;
+#ifdef __APPLE__
+  return Usage.ru_maxrss / 1024;
+#else
+  return Usage.ru_maxrss;
+#endif
+}
+
+unsigned RegisterASTClass(StringRef Name) {
+  std::lock_guard<std::mutex> Lock(MemoryLock);
+  auto It = std::find(ClassNames.begin(), ClassNames.end(), Name);
+  if (It != ClassNames.end())
+    return It - ClassNames.begin();
+  ClassNames.push_back(Name.str());
+  Classes.emplace_back();
+  return ClassNames.size() - 1;
+}
+
+unsigned getASTListID() {
+  static const unsigned ID = RegisterASTClass("(child lists)");
+  return ID;
+}
+
+void CountASTNode(unsigned ClassID, size_t Bytes) {
+  if (CurrentNodes.size() <= ClassID)
+    CurrentNodes.resize(ClassID + 1);
+  ++CurrentNodes[ClassID].Nodes;
+  CurrentNodes[ClassID].Bytes += Bytes;
+}
+
+/// Get the record of a function, adding it if it is new. The lock must be
+/// held.
+static FunctionMemory &getFunctionMemory(StringRef Function) {
+  auto Inserted = FunctionIndex.try_emplace(Function, Functions.size());
+  if (Inserted.second)
+    Functions.emplace_back(Function.str(), FunctionMemory());
+  return Functions[Inserted.first->second].second;
+}
+
+static void TakeTableSize(unsigned Table, size_t Entries, size_t Bytes) {
+  Tables[Table].Entries = std::max(Tables[Table].Entries, Entries);
+  Tables[Table].Bytes = std::max(Tables[Table].Bytes, Bytes);
+}
+
+void RecordDeclarationMemory(StringRef Function, size_t ArenaBytes) {
+  if (!MemReportEnabled)
+    return;
+  long PeakRSS = getPeakRSS();
+  // Registered before taking the lock, which registering takes.
+  unsigned ListID = getASTListID();
+  std::lock_guard<std::mutex> Lock(MemoryLock);
+
+  size_t Nodes = 0;
+  for (unsigned i = 0; i != CurrentNodes.size(); ++i) {
+    Classes[i].Nodes += CurrentNodes[i].Nodes;
+    Classes[i].Bytes += CurrentNodes[i].Bytes;
+    if (i != ListID)
+      Nodes += CurrentNodes[i].Nodes;
+  }
+  CurrentNodes.clear();
+
+  // The peak is that of the whole process, so with several threads it goes
+  // to whichever declaration is done first.
+  long Growth = PeakRSS > LastPeakRSS ? PeakRSS - LastPeakRSS : 0;
+  LastPeakRSS = std::max(LastPeakRSS, PeakRSS);
+  if (!Function.empty()) {
+    auto &FM = getFunctionMemory(Function);
+    FM.ASTNodes += Nodes;
+    FM.ASTBytes += ArenaBytes;
+    FM.RSSGrowth += Growth;
+  }
+
+  // Local tables are taken at their largest, as they are empty again by the
+  // end of a declaration.
+  TakeTableSize(table_local_decls, LocalDecls.getPeakSize(),
+                LocalDecls.getMemorySize());
+  TakeTableSize(table_global_decls, GlobalDecls.size(),
+                GlobalDecls.getMemorySize());
+  TakeTableSize(table_function_decls, FunctionDecls.size(),
+                FunctionDecls.getMemorySize());
+  TakeTableSize(table_defined_functions, DefinedFunctions.size(),
+                DefinedFunctions.getMemorySize());
+  TakeTableSize(table_local_values, LocalValues.size(),
+                LocalValues.getMemorySize());
+  TakeTableSize(table_named_globals, NamedGlobals.size(),
+                NamedGlobals.getMemorySize());
+  TakeTableSize(table_named_functions, NamedFunctions.size(),
+                NamedFunctions.getMemorySize());
+}
+
+void RecordFunctionIR(const Function &F, bool Optimized) {
+  if (!MemReportEnabled)
+    return;
+  size_t Blocks = F.size(), Instructions = F.getInstructionCount();
+  std::lock_guard<std::mutex> Lock(MemoryLock);
+  auto &FM = getFunctionMemory(F.getName());
+  if (Optimized) {
+    FM.OptBlocks = Blocks;
+    FM.OptInstructions = Instructions;
+  } else {
+    FM.Blocks = Blocks;
+    FM.Instructions = Instructions;
+  }
+}
+
+void RecordPhaseMemory(StringRef Phase) {
+  if (!MemReportEnabled)
+    return;
+  long PeakRSS = getPeakRSS();
+  std::lock_guard<std::mutex> Lock(MemoryLock);
+  Phases.emplace_back(Phase.str(), PeakRSS);
+  LastPeakRSS = std::max(LastPeakRSS, PeakRSS);
+}
+
+/// Functions shown in the table, the largest first.
+static constexpr unsigned MaxTableFunctions = 20;
+
+static void PrintTable(ArrayRef<unsigned> SortedClasses,
+                       ArrayRef<FunctionEntry *> Largest) {
+  fprintf(stderr,
+          "===-------------------------------------------------------------"
+          "------------===\n"
+          "                              Memory report\n"
+          "===-------------------------------------------------------------"
+          "------------===\n"
+          "  %-24s %12s %12s\n",
+          "Peak RSS after", "KiB", "+KiB");
+  long Last = 0;
+  for (auto &Phase : Phases) {
+    fprintf(stderr, "  %-24s %12ld %12ld\n", Phase.first.c_str(),
+            Phase.second, Phase.second - Last);
+    Last = Phase.second;
+  }
+
+  size_t TotalNodes = 0, TotalBytes = 0;
+  fprintf(stderr, "\n  %-24s %12s %12s\n", "AST class", "Nodes", "Bytes");
+  for (unsigned i : SortedClasses) {
+    fprintf(stderr, "  %-24s %12zu %12zu\n", ClassNames[i].c_str(),
+            Classes[i].Nodes, Classes[i].Bytes);
+    if (i != getASTListID())
+      TotalNodes += Classes[i].Nodes;
+    TotalBytes += Classes[i].Bytes;
+  }
+  fprintf(stderr, "  %-24s %12zu %12zu\n", "total", TotalNodes, TotalBytes);
+
+  fprintf(stderr, "\n  %-24s %12s %12s\n", "Symbol table", "Entries",
+          "Bytes");
+  fprintf(stderr, "  %-24s %12zu %12s\n", "symbols (interned)",
+          getNumSymbols() - 1, "-");
+  for (unsigned i = 0; i != num_tables; ++i)
+    fprintf(stderr, "  %-24s %12zu %12zu\n", TableNames[i], Tables[i].Entries,
+            Tables[i].Bytes);
+
+  if (!Largest.empty()) {
+    fprintf(stderr, "\n  %-24s %9s %9s %7s %7s %7s %7s %9s\n", "Function",
+            "AST nodes", "AST bytes", "blocks", "insts", "opt bb",
+            "opt ins", "RSS +KiB");
+    for (auto *F : Largest)
+      fprintf(stderr, "  %-24s %9zu %9zu %7zu %7zu %7zu %7zu %9ld\n",
+              F->first.c_str(), F->second.ASTNodes, F->second.ASTBytes,
+              F->second.Blocks, F->second.Instructions, F->second.OptBlocks,
+              F->second.OptInstructions, F->second.RSSGrowth);
+    if (Functions.size() > Largest.size())
+      fprintf(stderr, "  (%zu more functions)\n",
+              Functions.size() - Largest.size());
+  }
+}
+
+static void PrintJSON(ArrayRef<unsigned> SortedClasses) {
+  json::OStream J(errs(), 2);
+  J.object([&] {
+    J.attributeArray("peak_rss_kib", [&] {
+      for (auto &Phase : Phases)
+        J.object([&] {
+          J.attribute("phase", Phase.first);
+          J.attribute("kib", (int64_t)Phase.second);
+        });
+    });
+    J.attributeArray("ast_classes", [&] {
+      for (unsigned i : SortedClasses)
+        J.object([&] {
+          J.attribute("name", ClassNames[i]);
+          J.attribute("nodes", (int64_t)Classes[i].Nodes);
+          J.attribute("bytes", (int64_t)Classes[i].Bytes);
+        });
+    });
+    J.attributeArray("symbol_tables", [&] {
+      J.object([&] {
+        J.attribute("name", "symbols");
+        J.attribute("entries", (int64_t)getNumSymbols() - 1);
+      });
+      for (unsigned i = 0; i != num_tables; ++i)
+        J.object([&] {
+          J.attribute("name", TableNames[i]);
+          J.attribute("entries", (int64_t)Tables[i].Entries);
+          J.attribute("bytes", (int64_t)Tables[i].Bytes);
+        });
+    });
+    J.attributeArray("functions", [&] {
+      for (auto &F : Functions)
+        J.object([&] {
+          J.attribute("name", F.first);
+          J.attribute("ast_nodes", (int64_t)F.second.ASTNodes);
+          J.attribute("ast_bytes", (int64_t)F.second.ASTBytes);
+          J.attribute("blocks", (int64_t)F.second.Blocks);
+          J.attribute("instructions", (int64_t)F.second.Instructions);
+          J.attribute("opt_blocks", (int64_t)F.second.OptBlocks);
+          J.attribute("opt_instructions", (int64_t)F.second.OptInstructions);
+          J.attribute("rss_growth_kib", (int64_t)F.second.RSSGrowth);
+        });
+    });
+  });
+  errs() << "\n";
+  errs().flush();
+}
+
+void PrintMemReport(bool JSON) {
+  RecordDeclarationMemory("", 0);
+  std::lock_guard<std::mutex> Lock(MemoryLock);
+
+  std::vector<unsigned> SortedClasses;
+  for (unsigned i = 0; i != Classes.size(); ++i)
+    if (Classes[i].Nodes)
+      SortedClasses.push_back(i);
+  std::stable_sort(SortedClasses.begin(), SortedClasses.end(),
+                   [](unsigned A, unsigned B) {
+                     return Classes[A].Bytes > Classes[B].Bytes;
+                   });
+
+  if (JSON) {
+    PrintJSON(SortedClasses);
+    return;
+  }
+
+  std::vector<FunctionEntry *> Largest;
+  for (auto &F : Functions)
+    Largest.push_back(&F);
+  std::stable_sort(Largest.begin(), Largest.end(),
+                   [](FunctionEntry *A, FunctionEntry *B) {
+                     return A->second.ASTBytes > B->second.ASTBytes;
+                   });
+  if (Largest.size() > MaxTableFunctions)
+    Largest.resize(MaxTableFunctions);
+  PrintTable(SortedClasses, Largest);
+}
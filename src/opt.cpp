@@ -0,0 +1,146 @@
+#include "opt.h"
+#include "timing.h"
+#include <chrono>
+#include <cstdio>
+#include <llvm/ADT/Any.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/IR/PassTimingInfo.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/raw_ostream.h>
+
+static OptimizationLevel getOptimizationLevel(unsigned OptLevel) {
+  switch (OptLevel) {
+  case 0:
+    return OptimizationLevel::O0;
+  case 1:
+    return OptimizationLevel::O1;
+  case 2:
+    return OptimizationLevel::O2;
+  default:
+    return OptimizationLevel::O3;
+  }
+}
+
+namespace {
+/**
+ * @brief Times passes and analyses for `-ftime-report`, each without the
+ * ones it runs itself.
+ */
+class PassTimer {
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief A pass or analysis that is running.
+   */
+  struct Run {
+    StringRef Name;
+    bool isAnalysis;
+    std::string Function;
+    Clock::time_point Start;
+    /**
+     * @brief Time taken by the passes and analyses it has run.
+     */
+    double Nested = 0;
+  };
+  SmallVector<Run, 8> Stack;
+
+  /// Adaptors and managers only run other passes, which are timed instead.
+  static bool isTimed(StringRef Name) {
+    return !isSpecialPass(Name, {"PassManager", "PassAdaptor",
+                                 "AnalysisManagerProxy",
+                                 "DevirtSCCRepeatedPass",
+                                 "ModuleInlinerWrapperPass"});
+  }
+
+  static std::string getFunctionName(Any IR) {
+    if (const auto *F = any_cast<const Function *>(&IR))
+      return (*F)->getName().str();
+    if (const auto *L = any_cast<const Loop *>(&IR))
+      return (*L)->getHeader()->getParent()->getName().str();
+    return "";
+  }
+
+  void start(StringRef Name, bool isAnalysis, Any IR) {
+    if (isTimed(Name))
+      Stack.push_back({Name, isAnalysis, getFunctionName(IR), Clock::now()});
+  }
+
+  void stop(StringRef Name) {
+    if (!isTimed(Name))
+      return;
+    Run R = Stack.pop_back_val();
+    double Seconds =
+        std::chrono::duration<double>(Clock::now() - R.Start).count();
+    if (!Stack.empty())
+      Stack.back().Nested += Seconds;
+    RecordPassTime(R.Name, R.isAnalysis, R.Function, Seconds - R.Nested);
+  }
+
+public:
+  void registerCallbacks(PassInstrumentationCallbacks &PIC) {
+    PIC.registerBeforeNonSkippedPassCallback(
+        [this](StringRef Name, Any IR) { start(Name, false, IR); });
+    PIC.registerAfterPassCallback(
+        [this](StringRef Name, Any, const PreservedAnalyses &) {
+          stop(Name);
+        });
+    PIC.registerAfterPassInvalidatedCallback(
+        [this](StringRef Name, const PreservedAnalyses &) { stop(Name); });
+    PIC.registerBeforeAnalysisCallback(
+        [this](StringRef Name, Any IR) { start(Name, true, IR); });
+    PIC.registerAfterAnalysisCallback(
+        [this](StringRef Name, Any) { stop(Name); });
+  }
+};
+} // namespace
+
+int OptimizeModule(Module &M, TargetMachine *TM, unsigned OptLevel,
+                   const std::string &Pipeline, bool TimePasses) {
+  // The default pipelines assume well-formed input, so refuse to run them on
+  // broken IR instead of crashing halfway through.
+  if ((OptLevel > 0 || !Pipeline.empty()) && verifyModule(M, &errs())) {
+    fprintf(stderr, "Error: generated IR is invalid, not optimizing\n");
+    return 1;
+  }
+
+  PassInstrumentationCallbacks PIC;
+  TimePassesHandler TimePassesH(TimePasses);
+  TimePassesH.registerCallbacks(PIC);
+  PassTimer Timer;
+  if (TimeReportEnabled)
+    Timer.registerCallbacks(PIC);
+
+  PassBuilder PB(TM, PipelineTuningOptions(), {}, &PIC);
+
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  ModulePassManager MPM;
+  if (!Pipeline.empty()) {
+    if (auto Err = PB.parsePassPipeline(MPM, Pipeline)) {
+      fprintf(stderr, "Error: invalid pass pipeline '%s': %s\n",
+              Pipeline.c_str(), toString(std::move(Err)).c_str());
+      return 1;
+    }
+  } else if (OptLevel == 0) {
+    MPM = PB.buildO0DefaultPipeline(OptimizationLevel::O0);
+  } else {
+    MPM = PB.buildPerModuleDefaultPipeline(getOptimizationLevel(OptLevel));
+  }
+
+  MPM.run(M, MAM);
+  return 0;
+}
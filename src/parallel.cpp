@@ -0,0 +1,248 @@
+#include "parallel.h"
+#include "ir.h"
+#include "lexer.h"
+#include "memreport.h"
+#include "parser.h"
+#include "timing.h"
+#include <cstdio>
+#include <deque>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * @brief A function definition and the part module generated from it.
+ */
+struct Part {
+  /**
+   * @brief The definition.
+   */
+  FunctionAST *Function;
+  /**
+   * @brief Nodes of the definition, freed by the worker when it is done.
+   */
+  std::unique_ptr<ASTArena> Nodes;
+  /**
+   * @brief Bitcode of the part module, which carries it over to the context
+   * of TheModule. Empty if generating the function fails.
+   */
+  SmallVector<char, 0> Bitcode;
+};
+} // namespace
+
+static std::unique_ptr<ThreadPool> Workers;
+/// Queued definitions in source order. A deque does not move them, so
+/// workers can fill them in while more are queued.
+static std::deque<Part> Parts;
+
+/// Load bitcode written on another thread into the context of TheModule.
+static std::unique_ptr<Module> ParseBitcode(const SmallVectorImpl<char> &BC) {
+  auto M = parseBitcodeFile(
+      MemoryBufferRef(StringRef(BC.data(), BC.size()), "part"), *TheContext);
+  if (!M) {
+    fprintf(stderr, "Error: %s\n", toString(M.takeError()).c_str());
+    return nullptr;
+  }
+  return std::move(*M);
+}
+
+/// Generate one part on a worker, in the context of that worker.
+static void GeneratePart(Part &P) {
+  {
+    TimeScope Scope(time_irgen);
+    InitializePartModule();
+    if (P.Function->codegen()) {
+      raw_svector_ostream OS(P.Bitcode);
+      WriteBitcodeToFile(*TheModule, OS);
+    }
+    TheModule.reset();
+  }
+  StringRef Name = getSymbolName(P.Function->getProto()->getName());
+  RecordDeclarationTimes(Name);
+  // Its nodes were counted when it was parsed; this takes the tables of the
+  // worker.
+  RecordDeclarationMemory(Name, 0);
+  P.Nodes.reset();
+}
+
+void StartParallelCodegen(unsigned Threads) {
+  Workers = std::make_unique<ThreadPool>(hardware_concurrency(Threads));
+}
+
+int QueueFunction(FunctionAST *F, std::unique_ptr<ASTArena> Nodes) {
+  // Declared here, the function takes the same place in TheModule as it
+  // would if it were generated in place.
+  auto *Proto = F->getProto();
+  if (!NamedFunctions.lookup(Proto->getName()) && !Proto->codegen())
+    return 1;
+
+  Parts.push_back({F, std::move(Nodes), {}});
+  Part &P = Parts.back();
+  Workers->async([&P] { GeneratePart(P); });
+  return 0;
+}
+
+void MoveFunctions(Module &From, ArrayRef<Function *> Functions) {
+  for (auto *F : Functions) {
+    auto *Decl = TheModule->getFunction(F->getName());
+    F->removeFromParent();
+    TheModule->getFunctionList().insert(Decl->getIterator(), F);
+    F->takeName(Decl);
+    Decl->replaceAllUsesWith(F);
+    Decl->eraseFromParent();
+  }
+
+  for (auto &GV : From.global_values()) {
+    if (GV.use_empty())
+      continue;
+    auto *New = TheModule->getNamedValue(GV.getName());
+    if (New && New->getType() == GV.getType())
+      GV.replaceAllUsesWith(New);
+  }
+}
+
+int FinishParallelCodegen() {
+  Workers->wait();
+
+  // The parts are moved in rather than linked. The linker would put every
+  // definition and every global a part uses at the end of TheModule, and
+  // takes longer the larger TheModule gets.
+  TimeScope Scope(time_irgen);
+  int ret = 0;
+  for (auto &P : Parts) {
+    if (P.Bitcode.empty()) {
+      ret = 1;
+      continue;
+    }
+    auto PartModule = ParseBitcode(P.Bitcode);
+    if (!PartModule) {
+      ret = 1;
+      continue;
+    }
+    SmallVector<Function *, 1> Defined;
+    for (auto &F : *PartModule)
+      if (!F.isDeclaration())
+        Defined.push_back(&F);
+    MoveFunctions(*PartModule, Defined);
+  }
+  Parts.clear();
+  Workers.reset();
+
+  for (auto &Entry : NamedFunctions)
+    Entry.second = TheModule->getFunction(getSymbolName(Entry.first));
+
+  return ret;
+}
+
+namespace {
+/**
+ * @brief What compiling a translation unit on a worker leaves behind.
+ */
+struct Unit {
+  /**
+   * @brief 0 if nothing goes wrong; 1 otherwise.
+   */
+  int Ret = 0;
+  /**
+   * @brief Bitcode of the module of the unit.
+   */
+  SmallVector<char, 0> Bitcode;
+};
+} // namespace
+
+/// Compile one unit on a worker, from the source to bitcode.
+static void CompileUnit(const std::string &File, bool SyntaxOnly, Unit &U) {
+  UnitName = File.c_str();
+  if (OpenSource(File)) {
+    U.Ret = 1;
+    return;
+  }
+  getNextToken();
+
+  if (SyntaxOnly) {
+    U.Ret = MainLoop(/*SyntaxOnly=*/true, 0);
+    return;
+  }
+
+  InitializeModule();
+  U.Ret = MainLoop(/*SyntaxOnly=*/false, 0);
+  if (U.Ret == 0) {
+    raw_svector_ostream OS(U.Bitcode);
+    WriteBitcodeToFile(*TheModule, OS);
+  }
+  // Free the unit now instead of when the worker ends.
+  Builder.reset();
+  TheModule.reset();
+  TheContext.reset();
+}
+
+/// Check that a unit agrees with the units linked before it on the globals
+/// and functions they share. Semantic analysis only sees one unit, and the
+/// linker would either give up without naming the files or, for functions
+/// whose types differ, let the call go through anyway.
+/// @param Definers The file that defines each global or function so far.
+static int CheckUnitSymbols(Module &M, StringRef File,
+                            StringMap<StringRef> &Definers) {
+  int ret = 0;
+  for (auto &GV : M.global_values()) {
+    if (!GV.isDeclaration()) {
+      auto Inserted = Definers.try_emplace(GV.getName(), File);
+      if (!Inserted.second) {
+        fprintf(stderr, "Error: '%s' is defined in both '%s' and '%s'\n",
+                GV.getName().str().c_str(),
+                Inserted.first->getValue().str().c_str(), File.str().c_str());
+        ret = 1;
+        continue;
+      }
+    }
+
+    auto *Existing = TheModule->getNamedValue(GV.getName());
+    if (Existing && (Existing->getValueType() != GV.getValueType() ||
+                     isa<Function>(Existing) != isa<Function>(GV))) {
+      fprintf(stderr, "Error: '%s' in '%s' conflicts with an earlier file\n",
+              GV.getName().str().c_str(), File.str().c_str());
+      ret = 1;
+    }
+  }
+  return ret;
+}
+
+int CompileUnits(ArrayRef<std::string> Files, unsigned Threads,
+                 bool SyntaxOnly) {
+  std::vector<Unit> Units(Files.size());
+  {
+    ThreadPool Pool(hardware_concurrency(Threads));
+    for (size_t i = 0, e = Files.size(); i != e; ++i)
+      Pool.async([&, i] { CompileUnit(Files[i], SyntaxOnly, Units[i]); });
+    Pool.wait();
+  }
+
+  int ret = 0;
+  for (auto &U : Units)
+    ret |= U.Ret;
+  if (ret || SyntaxOnly)
+    return ret;
+
+  // The units end up in one module, where the optimizer can inline across
+  // them.
+  Linker L(*TheModule);
+  StringMap<StringRef> Definers;
+  for (size_t i = 0, e = Files.size(); i != e; ++i) {
+    auto M = ParseBitcode(Units[i].Bitcode);
+    if (!M || CheckUnitSymbols(*M, Files[i], Definers)) {
+      ret = 1;
+      continue;
+    }
+    if (L.linkInModule(std::move(M)))
+      ret = 1;
+  }
+  return ret;
+}
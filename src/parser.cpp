@@ -1,74 +1,148 @@
 #include "parser.h"
 #include "AST.h"
+#include "incremental.h"
 #include "ir.h"
 #include "lexer.h"
+#include "memreport.h"
+#include "parallel.h"
+#include "sema.h"
+#include "timing.h"
+#include <llvm/ADT/SmallVector.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/Support/Casting.h>
 #include <llvm/Support/CodeGen.h>
 #include <llvm/Support/raw_ostream.h>
-#include <map>
 #include <memory>
 #include <pthread.h>
 #include <string>
 #include <utility>
 
-int CurTok;
-std::map<int, int> BinopPrecedence;
+thread_local int CurTok;
+thread_local const char *UnitName = nullptr;
+
+namespace {
+/**
+ * @brief Precedence and associativity of every binary operator, indexed by
+ * token. Tokens that are not binary operators have precedence 0.
+ */
+class BinopTable {
+  /**
+   * @brief Offset added to a token to index the table, as `Token`s are
+   * negative.
+   */
+  static constexpr int Bias = -tok_const;
+
+  unsigned char Prec[Bias + 256];
+  bool RightAssoc[Bias + 256];
+
+  constexpr void set(int Tok, unsigned char P, bool Right = false) {
+    Prec[Bias + Tok] = P;
+    RightAssoc[Bias + Tok] = Right;
+  }
+
+public:
+  constexpr BinopTable() : Prec(), RightAssoc() {
+    set('=', 2, /*Right=*/true);
+    set(tok_land, 20);
+    set(tok_lor, 20);
+    set('<', 30);
+    set('>', 30);
+    set(tok_eq, 30);
+    set(tok_ne, 30);
+    set(tok_le, 30);
+    set(tok_ge, 30);
+    set('+', 40);
+    set('-', 40);
+    set('*', 50);
+    set('/', 50);
+    set('%', 50);
+  }
 
-int getNextToken() { return CurTok = gettok(); }
+  /**
+   * @brief Get the precedence of a token.
+   * @return Its precedence, or 0 if it is not a binary operator.
+   */
+  constexpr int getPrecedence(int Tok) const {
+    return Tok >= -Bias && Tok < 256 ? Prec[Bias + Tok] : 0;
+  }
+  /**
+   * @brief See if a binary operator groups from right to left.
+   * @return True if yes and false if no.
+   */
+  constexpr bool isRightAssoc(int Tok) const { return RightAssoc[Bias + Tok]; }
+};
+} // namespace
+
+static constexpr BinopTable Binops;
+
+/// Nodes of the top-level declaration being parsed. Reset after its codegen,
+/// or handed over to a worker along with a function definition.
+static thread_local std::unique_ptr<ASTArena> DeclArena =
+    std::make_unique<ASTArena>();
+/// Prototypes, which outlive their declaration in `FunctionDecls`.
+static thread_local ASTArena ProtoArena;
+
+int getNextToken() {
+  if (TimeReportEnabled) {
+    TimeScope Scope(time_lex);
+    return CurTok = gettok();
+  }
+  return CurTok = gettok();
+}
 
 int GetTokPrecedence() {
   // if (!isascii(CurTok))
   //   return -1;
 
-  int TokPrec = BinopPrecedence[CurTok];
+  int TokPrec = Binops.getPrecedence(CurTok);
   if (TokPrec <= 0)
     return -1;
   return TokPrec;
 }
 
-std::unique_ptr<ExprAST> LogError(const char *Str) {
-  fprintf(stderr, "line %u Error: %s\n", NR, Str);
+ExprAST *LogError(const char *Str) {
+  fprintf(stderr, "%s%sline %u Error: %s\n", UnitName ? UnitName : "",
+          UnitName ? ": " : "", NR, Str);
   return nullptr;
 }
 
-std::unique_ptr<StmtAST> LogErrorS(const char *Str) {
+StmtAST *LogErrorS(const char *Str) {
   LogError(Str);
   return nullptr;
 }
 
-std::unique_ptr<DeclAST> LogErrorD(const char *Str) {
+DeclAST *LogErrorD(const char *Str) {
   LogError(Str);
   return nullptr;
 }
 
-std::unique_ptr<PrototypeAST> LogErrorP(const char *Str) {
+PrototypeAST *LogErrorP(const char *Str) {
   LogError(Str);
   return nullptr;
 }
 
-std::unique_ptr<ExprAST> ParseExpression();
+ExprAST *ParseExpression();
 
-std::unique_ptr<ExprAST> ParseIntExpr() {
-  auto Result = std::make_unique<IntExprAST>((unsigned)NumVal);
+ExprAST *ParseIntExpr() {
+  auto Result = DeclArena->create<IntExprAST>((unsigned)IntVal);
   getNextToken();
   return Result;
 }
 
-std::unique_ptr<ExprAST> ParseDoubleExpr() {
-  auto Result = std::make_unique<DoubleExprAST>(NumVal);
+ExprAST *ParseDoubleExpr() {
+  auto Result = DeclArena->create<DoubleExprAST>(NumVal);
   getNextToken();
   return Result;
 }
 
-std::unique_ptr<ExprAST> ParseBooleanExpr() {
-  auto Result = std::make_unique<BooleanExprAST>(CurTok == tok_true);
+ExprAST *ParseBooleanExpr() {
+  auto Result = DeclArena->create<BooleanExprAST>(CurTok == tok_true);
   getNextToken();
   return Result;
 }
 
-std::unique_ptr<ExprAST> ParseParenExpr() {
+ExprAST *ParseParenExpr() {
   getNextToken(); // '('
   auto V = ParseExpression();
   if (!V)
@@ -80,21 +154,21 @@ std::unique_ptr<ExprAST> ParseParenExpr() {
   return V;
 }
 
-std::unique_ptr<ExprAST> ParseIdentifierExpr() {
-  std::string IdName = IdentifierStr;
+ExprAST *ParseIdentifierExpr() {
+  SymbolID IdName = internSymbol(IdentifierStr);
 
   getNextToken();
 
   if (CurTok != '(')
-    return std::make_unique<VariableExprAST>(IdName);
+    return DeclArena->create<VariableExprAST>(IdName);
 
   // Call.
   getNextToken();
-  std::vector<std::unique_ptr<ExprAST>> Args;
+  SmallVector<ExprAST *, 8> Args;
   if (CurTok != ')') {
     while (true) {
       if (auto Arg = ParseExpression())
-        Args.push_back(std::move(Arg));
+        Args.push_back(Arg);
       else
         return nullptr;
 
@@ -109,12 +183,12 @@ std::unique_ptr<ExprAST> ParseIdentifierExpr() {
 
   getNextToken();
 
-  return std::make_unique<CallExprAST>(IdName, std::move(Args));
+  return DeclArena->create<CallExprAST>(IdName, DeclArena->copy<ExprAST *>(Args));
 }
 
-std::unique_ptr<StmtAST> ParseStatement();
+StmtAST *ParseStatement();
 
-std::unique_ptr<StmtAST> ParseIfStmt() {
+StmtAST *ParseIfStmt() {
   getNextToken(); // eat "if"
 
   if (CurTok != '(')
@@ -133,7 +207,7 @@ std::unique_ptr<StmtAST> ParseIfStmt() {
   if (!Then)
     return nullptr;
 
-  std::unique_ptr<StmtAST> Else = nullptr;
+  StmtAST *Else = nullptr;
   if (CurTok == tok_else) {
     getNextToken();
     Else = ParseStatement();
@@ -141,13 +215,12 @@ std::unique_ptr<StmtAST> ParseIfStmt() {
       return nullptr;
   }
 
-  return std::make_unique<IfStmtAST>(std::move(Cond), std::move(Then),
-                                     std::move(Else));
+  return DeclArena->create<IfStmtAST>(Cond, Then, Else);
 }
 
 enum CXType ParseType();
 
-std::unique_ptr<StmtAST> ParseSwitchStmt() {
+StmtAST *ParseSwitchStmt() {
   getNextToken(); // eat "swtich"
 
   if (CurTok != '(')
@@ -166,13 +239,12 @@ std::unique_ptr<StmtAST> ParseSwitchStmt() {
     return LogErrorS("Expect '{' in switch");
   getNextToken();
 
-  std::vector<std::pair<std::vector<std::unique_ptr<ExprAST>>,
-                        std::vector<std::unique_ptr<StmtAST>>>>
-      CaseList;
+  SmallVector<SwitchCase, 8> CaseList;
 
-  if (CurTok == '}')
-    return std::make_unique<SwitchStmtAST>(std::move(Expr),
-                                           std::move(CaseList));
+  if (CurTok == '}') {
+    getNextToken(); // eat '}'
+    return DeclArena->create<SwitchStmtAST>(Expr, ArrayRef<SwitchCase>());
+  }
 
   if (CurTok != tok_case && CurTok != tok_default) {
     return LogErrorS("Expect switch starting with 'case' or 'default'");
@@ -181,9 +253,9 @@ std::unique_ptr<StmtAST> ParseSwitchStmt() {
   bool hasDefault = false;
 
   do {
-    std::vector<std::unique_ptr<ExprAST>> Matches;
+    SmallVector<ExprAST *, 8> Matches;
     do {
-      std::unique_ptr<ExprAST> Match = nullptr;
+      ExprAST *Match = nullptr;
       if (CurTok == tok_case) {
         getNextToken();
         Match = ParseExpression();
@@ -199,26 +271,28 @@ std::unique_ptr<StmtAST> ParseSwitchStmt() {
         return LogErrorS("Expect ':' after 'case' or 'default'");
       getNextToken();
 
-      Matches.push_back(std::move(Match));
+      Matches.push_back(Match);
     } while (CurTok == tok_case || CurTok == tok_default);
 
-    std::vector<std::unique_ptr<StmtAST>> Stmts;
+    SmallVector<StmtAST *, 8> Stmts;
     while (CurTok != tok_case && CurTok != tok_default && CurTok != '}') {
       auto Stmt = ParseStatement();
       if (!Stmt)
         return nullptr;
-      Stmts.push_back(std::move(Stmt));
+      Stmts.push_back(Stmt);
     }
 
-    CaseList.push_back(std::make_pair(std::move(Matches), std::move(Stmts)));
+    CaseList.push_back({DeclArena->copy<ExprAST *>(Matches),
+                        DeclArena->copy<StmtAST *>(Stmts)});
   } while (CurTok == tok_case || CurTok == tok_default);
 
   getNextToken(); // eat '}'
 
-  return std::make_unique<SwitchStmtAST>(std::move(Expr), std::move(CaseList));
+  return DeclArena->create<SwitchStmtAST>(Expr,
+                                         DeclArena->copy<SwitchCase>(CaseList));
 }
 
-std::unique_ptr<StmtAST> ParseWhileStmt() {
+StmtAST *ParseWhileStmt() {
   getNextToken(); // eat "while"
 
   if (CurTok != '(')
@@ -237,10 +311,10 @@ std::unique_ptr<StmtAST> ParseWhileStmt() {
   if (!Stmt)
     return nullptr;
 
-  return std::make_unique<WhileStmtAST>(std::move(Cond), std::move(Stmt));
+  return DeclArena->create<WhileStmtAST>(Cond, Stmt);
 }
 
-std::unique_ptr<StmtAST> ParseDoStmt() {
+StmtAST *ParseDoStmt() {
   getNextToken(); // eat "do"
 
   auto Stmt = ParseStatement();
@@ -266,30 +340,29 @@ std::unique_ptr<StmtAST> ParseDoStmt() {
   if (CurTok != ';')
     return LogErrorS("Expect ';' after do-while");
 
-  return std::make_unique<DoStmtAST>(std::move(Stmt), std::move(Cond));
+  return DeclArena->create<DoStmtAST>(Stmt, Cond);
 }
 
-std::unique_ptr<StmtAST> ParseForStmt() {
+StmtAST *ParseForStmt() {
   getNextToken(); // eat "for"
 
   if (CurTok != '(')
     return LogErrorS("Expect '(' after for");
   getNextToken();
 
-  enum CXType IdType = typ_err;
-  std::string IdName = "";
-  std::unique_ptr<ExprAST> Start = nullptr;
+  VarDeclAST *Var = nullptr;
   if (CurTok != ';') {
-    IdType = ParseType();
+    auto IdType = ParseType();
     if (IdType == typ_err)
       return nullptr;
 
     if (CurTok != tok_identifier)
       return LogErrorS("Expect identifier in for");
 
-    IdName = IdentifierStr;
+    auto IdName = internSymbol(IdentifierStr);
     getNextToken();
 
+    ExprAST *Start = nullptr;
     if (CurTok == '=') {
       getNextToken();
 
@@ -299,10 +372,12 @@ std::unique_ptr<StmtAST> ParseForStmt() {
     }
     if (CurTok != ';')
       return LogErrorS("Expected ';' after loop variable definition");
+
+    Var = DeclArena->create<VarDeclAST>(false, IdType, IdName, Start);
   }
   getNextToken(); // eat ';'
 
-  std::unique_ptr<ExprAST> End = nullptr;
+  ExprAST *End = nullptr;
   if (CurTok != ';') {
     End = ParseExpression();
     if (!End)
@@ -312,7 +387,7 @@ std::unique_ptr<StmtAST> ParseForStmt() {
   }
   getNextToken(); // eat ';'
 
-  std::unique_ptr<ExprAST> Step = nullptr;
+  ExprAST *Step = nullptr;
   if (CurTok != ')') {
     Step = ParseExpression();
     if (!Step)
@@ -327,12 +402,10 @@ std::unique_ptr<StmtAST> ParseForStmt() {
   if (!Body)
     return nullptr;
 
-  return std::make_unique<ForStmtAST>(IdType, IdName, std::move(Start),
-                                      std::move(End), std::move(Step),
-                                      std::move(Body));
+  return DeclArena->create<ForStmtAST>(Var, End, Step, Body);
 }
 
-std::unique_ptr<StmtAST> ParseUntilStmt() {
+StmtAST *ParseUntilStmt() {
   getNextToken(); // eat "repeat"
 
   auto Stmt = ParseStatement();
@@ -358,10 +431,10 @@ std::unique_ptr<StmtAST> ParseUntilStmt() {
   if (CurTok != ';')
     return LogErrorS("Expect ';' after repeat-until");
 
-  return std::make_unique<UntilStmtAST>(std::move(Stmt), std::move(Cond));
+  return DeclArena->create<UntilStmtAST>(Stmt, Cond);
 }
 
-std::unique_ptr<StmtAST> ParseReadStmt() {
+StmtAST *ParseReadStmt() {
   getNextToken(); // eat "read"
 
   auto Var = ParseExpression();
@@ -372,10 +445,10 @@ std::unique_ptr<StmtAST> ParseReadStmt() {
     return LogErrorS("Expect ';' after read");
   getNextToken();
 
-  return std::make_unique<ReadStmtAST>(std::move(Var));
+  return DeclArena->create<ReadStmtAST>(Var);
 }
 
-std::unique_ptr<StmtAST> ParseWriteStmt() {
+StmtAST *ParseWriteStmt() {
   getNextToken(); // eat "write"
 
   auto Val = ParseExpression();
@@ -386,29 +459,28 @@ std::unique_ptr<StmtAST> ParseWriteStmt() {
     return LogErrorS("Expect ';' after read");
   getNextToken();
 
-  return std::make_unique<WriteStmtAST>(std::move(Val));
+  return DeclArena->create<WriteStmtAST>(Val);
 }
 
-std::unique_ptr<DeclAST> ParseDeclaration();
+DeclAST *ParseDeclaration();
 
-std::unique_ptr<StmtAST> ParseBlockStmt() {
+StmtAST *ParseBlockStmt() {
   getNextToken(); // eat '{'
 
-  std::vector<std::unique_ptr<BlockElemAST>> Elems;
+  SmallVector<BlockElemAST *, 8> Elems;
   while (CurTok != '}') {
     if (CurTok == tok_const || CurTok == tok_int || CurTok == tok_bool ||
         CurTok == tok_double) {
       auto Decl = ParseDeclaration();
       if (!Decl)
         return nullptr;
-      auto VarDecl = std::unique_ptr<VarDeclAST>{
-          static_cast<VarDeclAST *>(Decl.release())};
-      Elems.push_back(std::move(VarDecl));
+      auto VarDecl = cast<VarDeclAST>(Decl);
+      Elems.push_back(VarDecl);
     } else {
       auto Stmt = ParseStatement();
       if (!Stmt)
         return nullptr;
-      Elems.push_back(std::move(Stmt));
+      Elems.push_back(Stmt);
     }
   }
 
@@ -416,10 +488,10 @@ std::unique_ptr<StmtAST> ParseBlockStmt() {
   //   return LogErrorS("Expect '}' after block");
   getNextToken();
 
-  return std::make_unique<BlockStmtAST>(std::move(Elems));
+  return DeclArena->create<BlockStmtAST>(DeclArena->copy<BlockElemAST *>(Elems));
 }
 
-std::unique_ptr<StmtAST> ParseRetStmt() {
+StmtAST *ParseRetStmt() {
   getNextToken(); // eat "return"
 
   auto Val = ParseExpression();
@@ -430,11 +502,11 @@ std::unique_ptr<StmtAST> ParseRetStmt() {
     return LogErrorS("Expect ';' after return");
   getNextToken();
 
-  return std::make_unique<RetStmtAST>(std::move(Val));
+  return DeclArena->create<RetStmtAST>(Val);
 }
 
-std::unique_ptr<StmtAST> ParseExprStmt() {
-  std::unique_ptr<ExprAST> Expr = nullptr;
+StmtAST *ParseExprStmt() {
+  ExprAST *Expr = nullptr;
   if (CurTok != ';') {
     Expr = ParseExpression();
     if (!Expr)
@@ -442,34 +514,34 @@ std::unique_ptr<StmtAST> ParseExprStmt() {
   }
   getNextToken(); // eat ';'
 
-  return std::make_unique<ExprStmtAST>(std::move(Expr));
+  return DeclArena->create<ExprStmtAST>(Expr);
 }
 
-std::unique_ptr<StmtAST> ParseContStmt() {
+StmtAST *ParseContStmt() {
   getNextToken();
   if (CurTok != ';')
     return LogErrorS("Expect ';' after continue");
-  return std::make_unique<ContStmtAST>();
+  return DeclArena->create<ContStmtAST>();
 }
 
-std::unique_ptr<StmtAST> ParseBrkStmt() {
+StmtAST *ParseBrkStmt() {
   getNextToken();
   if (CurTok != ';')
     return LogErrorS("Expect ';' after break");
-  return std::make_unique<BrkStmtAST>();
+  return DeclArena->create<BrkStmtAST>();
 }
 
-std::unique_ptr<StmtAST> ParseExitStmt() {
+StmtAST *ParseExitStmt() {
   getNextToken();
   auto ExitCode = ParseExpression();
   if (!ExitCode)
     return nullptr;
   if (CurTok != ';')
     return LogErrorS("Expect ';' after exit");
-  return std::make_unique<ExitStmtAST>(std::move(ExitCode));
+  return DeclArena->create<ExitStmtAST>(ExitCode);
 }
 
-std::unique_ptr<StmtAST> ParseStatement() {
+StmtAST *ParseStatement() {
   switch (CurTok) {
   default:
     return LogErrorS("unknown token when expecting a statement");
@@ -515,7 +587,7 @@ std::unique_ptr<StmtAST> ParseStatement() {
   }
 }
 
-std::unique_ptr<ExprAST> ParseCastExpr() {
+ExprAST *ParseCastExpr() {
   getNextToken(); // eat "cast"
 
   if (CurTok != '<')
@@ -537,10 +609,10 @@ std::unique_ptr<ExprAST> ParseCastExpr() {
   if (!From)
     return nullptr;
 
-  return std::make_unique<CastExprAST>(Type, std::move(From));
+  return DeclArena->create<CastExprAST>(Type, From);
 }
 
-std::unique_ptr<ExprAST> ParsePrimary() {
+ExprAST *ParsePrimary() {
   switch (CurTok) {
   default:
     return LogError("unknown token when expecting an expression");
@@ -561,7 +633,7 @@ std::unique_ptr<ExprAST> ParsePrimary() {
   }
 }
 
-std::unique_ptr<ExprAST> ParseUnary() {
+ExprAST *ParseUnary() {
   if (CurTok == tok_identifier || CurTok == tok_intliteral ||
       CurTok == tok_doubleliteral || CurTok == tok_true ||
       CurTok == tok_false || CurTok == '(' || CurTok == tok_cast)
@@ -570,45 +642,51 @@ std::unique_ptr<ExprAST> ParseUnary() {
   int Opc = CurTok;
   getNextToken();
   if (auto Operand = ParseUnary())
-    return std::make_unique<UnaryExprAST>(Opc, std::move(Operand));
+    return DeclArena->create<UnaryExprAST>(Opc, Operand);
   return nullptr;
 }
 
-std::unique_ptr<ExprAST> ParseBinOpRHS(int ExprPrec,
-                                       std::unique_ptr<ExprAST> LHS) {
+ExprAST *ParseExpression() {
+  auto LHS = ParseUnary();
+  if (!LHS)
+    return nullptr;
+
+  // Operator precedence parsing with explicit stacks instead of recursion, so
+  // that the depth of the native stack does not grow with the expression.
+  // Operators waiting for their right operand are kept in order of strictly
+  // increasing precedence, each with its left operand below it.
+  SmallVector<ExprAST *, 8> Operands;
+  SmallVector<int, 8> Operators;
+  Operands.push_back(LHS);
+
   while (true) {
     int TokPrec = GetTokPrecedence();
 
-    if (TokPrec < ExprPrec)
-      return LHS;
+    // Whatever binds at least as tightly as this operator is complete now.
+    while (!Operators.empty()) {
+      int TopPrec = Binops.getPrecedence(Operators.back());
+      if (TopPrec < TokPrec ||
+          (TopPrec == TokPrec && Binops.isRightAssoc(CurTok)))
+        break;
+      auto RHS = Operands.pop_back_val();
+      auto LHS = Operands.pop_back_val();
+      Operands.push_back(
+          DeclArena->create<BinaryExprAST>(Operators.pop_back_val(), LHS, RHS));
+    }
 
-    int BinOp = CurTok;
+    if (TokPrec < 0)
+      return Operands.back();
+
+    Operators.push_back(CurTok);
     getNextToken();
 
     auto RHS = ParseUnary();
     if (!RHS)
       return nullptr;
-
-    int NextPrec = GetTokPrecedence();
-    if (TokPrec < NextPrec) {
-      RHS = ParseBinOpRHS(TokPrec + 1, std::move(RHS));
-      if (!RHS)
-        return nullptr;
-    }
-
-    LHS =
-        std::make_unique<BinaryExprAST>(BinOp, std::move(LHS), std::move(RHS));
+    Operands.push_back(RHS);
   }
 }
 
-std::unique_ptr<ExprAST> ParseExpression() {
-  auto LHS = ParseUnary();
-  if (!LHS)
-    return nullptr;
-
-  return ParseBinOpRHS(0, std::move(LHS));
-}
-
 enum CXType ParseType() {
   enum CXType Type;
   switch (CurTok) {
@@ -629,7 +707,7 @@ enum CXType ParseType() {
   return Type;
 }
 
-std::unique_ptr<DeclAST> ParseDeclaration() {
+DeclAST *ParseDeclaration() {
   bool isConst = false;
   if (CurTok == tok_const) {
     isConst = true;
@@ -642,10 +720,10 @@ std::unique_ptr<DeclAST> ParseDeclaration() {
 
   if (CurTok != tok_identifier)
     return LogErrorD("Expected variable name in declaration");
-  std::string VarName = IdentifierStr;
+  SymbolID VarName = internSymbol(IdentifierStr);
   getNextToken();
 
-  std::unique_ptr<ExprAST> Val = nullptr;
+  ExprAST *Val = nullptr;
   if (CurTok == '=') {
     getNextToken();
     Val = ParseExpression();
@@ -655,10 +733,10 @@ std::unique_ptr<DeclAST> ParseDeclaration() {
   if (CurTok != ';')
     return LogErrorD("Expect ';' after declaration");
   getNextToken();
-  return std::make_unique<VarDeclAST>(isConst, Type, VarName, std::move(Val));
+  return DeclArena->create<VarDeclAST>(isConst, Type, VarName, Val);
 }
 
-std::unique_ptr<DeclAST> ParseTopLevelDeclaration() {
+DeclAST *ParseTopLevelDeclaration() {
   bool isConst = false;
   if (CurTok == tok_const) {
     isConst = true;
@@ -671,11 +749,11 @@ std::unique_ptr<DeclAST> ParseTopLevelDeclaration() {
 
   if (CurTok != tok_identifier)
     return LogErrorD("Expected variable name in declaration");
-  std::string VarName = IdentifierStr;
+  SymbolID VarName = internSymbol(IdentifierStr);
   getNextToken();
 
   if (CurTok != '(') {
-    std::unique_ptr<ExprAST> Val = nullptr;
+    ExprAST *Val = nullptr;
     if (CurTok == '=') {
       getNextToken();
       Val = ParseExpression();
@@ -685,8 +763,7 @@ std::unique_ptr<DeclAST> ParseTopLevelDeclaration() {
     if (CurTok != ';')
       return LogErrorD("Expect ';' after declaration");
     getNextToken();
-    return std::make_unique<GlobVarDeclAST>(isConst, Type, VarName,
-                                            std::move(Val));
+    return DeclArena->create<GlobVarDeclAST>(isConst, Type, VarName, Val);
   }
 
   // Prototype.
@@ -695,7 +772,7 @@ std::unique_ptr<DeclAST> ParseTopLevelDeclaration() {
 
   getNextToken(); // eat '('
 
-  std::vector<std::unique_ptr<VarDeclAST>> Params;
+  SmallVector<VarDeclAST *, 8> Params;
 
   if (CurTok != ')') {
     while (true) {
@@ -710,11 +787,11 @@ std::unique_ptr<DeclAST> ParseTopLevelDeclaration() {
 
       if (CurTok != tok_identifier)
         return LogErrorP("Expected variable name in prototype");
-      std::string ParamName = IdentifierStr;
+      SymbolID ParamName = internSymbol(IdentifierStr);
       getNextToken();
 
-      Params.push_back(std::make_unique<VarDeclAST>(isConstParam, ParamType,
-                                                    ParamName, nullptr));
+      Params.push_back(ProtoArena.create<VarDeclAST>(isConstParam, ParamType,
+                                                     ParamName, nullptr));
 
       if (CurTok == ')')
         break;
@@ -729,19 +806,22 @@ std::unique_ptr<DeclAST> ParseTopLevelDeclaration() {
 
   if (CurTok == ';') {
     getNextToken();
-    return std::make_unique<PrototypeAST>(Type, VarName, std::move(Params));
+    return ProtoArena.create<PrototypeAST>(
+        Type, VarName, ProtoArena.copy<VarDeclAST *>(Params));
   }
 
   if (CurTok != '{')
     return LogErrorP("Expected function body");
 
-  auto Proto = std::make_unique<PrototypeAST>(Type, VarName, std::move(Params));
+  auto Proto = ProtoArena.create<PrototypeAST>(
+      Type, VarName, ProtoArena.copy<VarDeclAST *>(Params));
+
+  if (isIncrementalBuild() && SkipUnchangedBody(Proto))
+    return DeclArena->create<FunctionAST>(Proto, nullptr);
 
   if (auto Body = ParseBlockStmt()) {
-    auto BlockBody = std::unique_ptr<BlockStmtAST>{
-        static_cast<BlockStmtAST *>(Body.release())};
-    return std::make_unique<FunctionAST>(std::move(Proto),
-                                         std::move(BlockBody));
+    auto BlockBody = cast<BlockStmtAST>(Body);
+    return DeclArena->create<FunctionAST>(Proto, BlockBody);
   }
   return nullptr;
 }
@@ -835,30 +915,55 @@ std::unique_ptr<DeclAST> ParseTopLevelDeclaration() {
 //   }
 // }
 
-int HandleTopLevelDeclaration() {
-  if (auto DeclAST = ParseTopLevelDeclaration()) {
-    if (DeclAST->isVarDecl()) {
-      auto D = std::unique_ptr<GlobVarDeclAST>(
-          static_cast<GlobVarDeclAST *>(DeclAST.release())); // WHY?
-      D->codegen();
-      if (!D)
-        return 1;
-      return 0;
-    }
+static int CodegenTopLevelDeclaration(DeclAST *Decl) {
+  return Decl->codegen() ? 0 : 1;
+}
 
-    // Function.
-    if (auto DeclIR = DeclAST->codegen()) {
-      // DeclIR->print(errs());
-      // fprintf(stderr, "\n");
+/// Get the name of the function a declaration declares, for time reports.
+static StringRef getDeclaredFunction(DeclAST *Decl) {
+  if (auto *F = dyn_cast<FunctionAST>(Decl))
+    return getSymbolName(F->getProto()->getName());
+  if (auto *P = dyn_cast<PrototypeAST>(Decl))
+    return getSymbolName(P->getName());
+  return "";
+}
 
-      auto P = std::unique_ptr<PrototypeAST>(
-          dynamic_cast<PrototypeAST *>(DeclAST.release()));
-      if (P)
-        NamedFns[P->getName()] = std::move(P);
-      return 0;
+int HandleTopLevelDeclaration(bool SyntaxOnly, bool Parallel) {
+  DeclAST *Decl;
+  {
+    TimeScope Scope(time_parse);
+    Decl = ParseTopLevelDeclaration();
+  }
+  if (Decl) {
+    int ret;
+    {
+      TimeScope Scope(time_sema);
+      ret = Decl->sema();
     }
-    return 1;
+    if (ret == 0 && Parallel && isa<FunctionAST>(Decl)) {
+      auto *F = cast<FunctionAST>(Decl);
+      RecordDeclarationMemory(getDeclaredFunction(F),
+                              DeclArena->getBytesAllocated());
+      if (isIncrementalBuild())
+        ret = AddIncrementalFunction(F, std::move(DeclArena));
+      else
+        ret = QueueFunction(F, std::move(DeclArena));
+      DeclArena = std::make_unique<ASTArena>();
+      RecordDeclarationTimes(getDeclaredFunction(F));
+      return ret;
+    }
+    if (ret == 0 && !SyntaxOnly) {
+      TimeScope Scope(time_irgen);
+      ret = CodegenTopLevelDeclaration(Decl);
+    }
+    RecordDeclarationTimes(getDeclaredFunction(Decl));
+    RecordDeclarationMemory(getDeclaredFunction(Decl),
+                            DeclArena->getBytesAllocated());
+    // Only the IR is needed from now on, so drop the whole tree at once.
+    DeclArena->reset();
+    return ret;
   }
+  DeclArena->reset();
 
   // Parsing fails.
   while (true) {
@@ -871,18 +976,30 @@ int HandleTopLevelDeclaration() {
   return 1;
 }
 
-int MainLoop() {
+int MainLoop(bool SyntaxOnly, unsigned Threads) {
+  // Start from scratch if the thread has checked another unit before.
+  ResetSema();
+  ProtoArena.reset();
+
+  bool Parallel = !SyntaxOnly && Threads > 0;
+  if (Parallel)
+    StartParallelCodegen(Threads);
+
   int ret = 0;
   while (true) {
     // fprintf(stderr, "ready> ");
     switch (CurTok) {
     case tok_eof:
+      if (Parallel)
+        ret |= FinishParallelCodegen();
+      RecordDeclarationTimes("");
+      RecordDeclarationMemory("", 0);
       return ret;
     case ';':
       getNextToken();
       break;
     default:
-      ret |= HandleTopLevelDeclaration();
+      ret |= HandleTopLevelDeclaration(SyntaxOnly, Parallel);
       break;
     }
   }
@@ -0,0 +1,703 @@
+#include "sema.h"
+#include "AST.h"
+#include "lexer.h"
+#include "parser.h"
+#include <cstdio>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Casting.h>
+
+thread_local ScopedSymbolTable<VarDeclAST *> LocalDecls;
+thread_local DenseMap<SymbolID, GlobalVarInfo> GlobalDecls;
+thread_local DenseMap<SymbolID, PrototypeAST *> FunctionDecls;
+thread_local DenseSet<SymbolID> DefinedFunctions;
+thread_local SmallVectorImpl<SymbolID> *ReferencedNames = nullptr;
+
+/// Return type of the function being checked.
+static thread_local enum CXType CurRetType = typ_err;
+/// Number of loops around the statement being checked, which `continue`
+/// needs, and of loops and switches, which `break` needs.
+static thread_local unsigned LoopDepth = 0, BreakableDepth = 0;
+
+void ResetSema() {
+  LocalDecls.clear();
+  GlobalDecls.clear();
+  FunctionDecls.clear();
+  DefinedFunctions.clear();
+}
+
+static enum CXType LogErrorT(const char *Str) {
+  LogError(Str);
+  return typ_err;
+}
+
+static int LogErrorC(const char *Str) {
+  LogError(Str);
+  return 1;
+}
+
+const char *getCXTypeName(const enum CXType T) {
+  switch (T) {
+  case typ_err:
+    break;
+  case typ_int:
+    return "int";
+  case typ_bool:
+    return "bool";
+  case typ_double:
+    return "double";
+  }
+  return "<error>";
+}
+
+static const char *getOperatorSpelling(int Op) {
+  switch (Op) {
+  case '+':
+    return "+";
+  case '-':
+    return "-";
+  case '*':
+    return "*";
+  case '/':
+    return "/";
+  case '%':
+    return "%";
+  case '<':
+    return "<";
+  case '>':
+    return ">";
+  case tok_le:
+    return "<=";
+  case tok_ge:
+    return ">=";
+  case tok_eq:
+    return "==";
+  case tok_ne:
+    return "!=";
+  case tok_lor:
+    return "||";
+  case tok_land:
+    return "&&";
+  }
+  return "?";
+}
+
+/**
+ * Report an operator applied to operands of a type it is not defined for.
+ */
+static enum CXType LogUndefinedOperator(int Op, enum CXType T) {
+  char Msg[64];
+  snprintf(Msg, sizeof(Msg), "operator '%s' not defined for %s",
+           getOperatorSpelling(Op), getCXTypeName(T));
+  return LogErrorT(Msg);
+}
+
+/**
+ * See if a variable expression, already checked, refers to a constant.
+ */
+static bool isConstVariable(VariableExprAST *V) {
+  if (auto *D = V->getDecl())
+    return D->isConstVar();
+  return GlobalDecls.lookup(V->getName()).isConst;
+}
+
+namespace {
+/**
+ * @brief Value of a constant expression.
+ */
+struct ConstValue {
+  /**
+   * @brief Value if the expression is an int or a bool, which is 0 or 1.
+   */
+  uint64_t Int = 0;
+  /**
+   * @brief Value if the expression is a double.
+   */
+  double FP = 0;
+};
+} // namespace
+
+/**
+ * Evaluate an expression that has been checked, folding it as IRBuilder does
+ * when it generates IR for the expression.
+ * @param E The expression.
+ * @param V Set to its value.
+ * @return Whether the expression is constant.
+ */
+static bool EvaluateConstant(ExprAST *E, ConstValue &V) {
+  switch (E->getKind()) {
+  case expr_int:
+    V.Int = cast<IntExprAST>(E)->getVal();
+    return true;
+  case expr_double:
+    V.FP = cast<DoubleExprAST>(E)->getVal();
+    return true;
+  case expr_boolean:
+    V.Int = cast<BooleanExprAST>(E)->getVal();
+    return true;
+
+  case expr_unary: {
+    auto *U = cast<UnaryExprAST>(E);
+    ConstValue O;
+    if (!EvaluateConstant(U->getOperand(), O))
+      return false;
+    switch (U->getOpcode()) {
+    case '!':
+      V.Int = !O.Int;
+      return true;
+    case tok_ODD:
+      V.Int = O.Int & 1;
+      return true;
+    }
+    return false;
+  }
+
+  case expr_binary: {
+    auto *B = cast<BinaryExprAST>(E);
+    ConstValue L, R;
+    if (B->getOp() == '=' || !EvaluateConstant(B->getLHS(), L) ||
+        !EvaluateConstant(B->getRHS(), R))
+      return false;
+
+    bool IsDouble = B->getLHS()->getCXType() == typ_double;
+    switch (B->getOp()) {
+    case '+':
+      V.Int = (uint32_t)(L.Int + R.Int);
+      V.FP = L.FP + R.FP;
+      return true;
+    case '-':
+      V.Int = (uint32_t)(L.Int - R.Int);
+      V.FP = L.FP - R.FP;
+      return true;
+    case '*':
+      V.Int = (uint32_t)(L.Int * R.Int);
+      V.FP = L.FP * R.FP;
+      return true;
+    case '/':
+      // Division by zero folds to poison, which is not a constant integer.
+      if (!IsDouble && !R.Int)
+        return false;
+      V.Int = IsDouble ? 0 : L.Int / R.Int;
+      V.FP = L.FP / R.FP;
+      return true;
+    case '%':
+      if (!R.Int)
+        return false;
+      V.Int = L.Int % R.Int;
+      return true;
+    case '<':
+      V.Int = IsDouble ? L.FP < R.FP : L.Int < R.Int;
+      return true;
+    case '>':
+      V.Int = IsDouble ? L.FP > R.FP : L.Int > R.Int;
+      return true;
+    case tok_le:
+      V.Int = IsDouble ? L.FP <= R.FP : L.Int <= R.Int;
+      return true;
+    case tok_ge:
+      V.Int = IsDouble ? L.FP >= R.FP : L.Int >= R.Int;
+      return true;
+    case tok_eq:
+      V.Int = IsDouble ? L.FP == R.FP : L.Int == R.Int;
+      return true;
+    case tok_ne:
+      // Ordered, as with `fcmp one`.
+      V.Int = IsDouble ? L.FP < R.FP || L.FP > R.FP : L.Int != R.Int;
+      return true;
+    case tok_lor:
+      V.Int = L.Int || R.Int;
+      return true;
+    case tok_land:
+      V.Int = L.Int && R.Int;
+      return true;
+    }
+    return false;
+  }
+
+  case expr_cast: {
+    auto *C = cast<CastExprAST>(E);
+    ConstValue F;
+    if (!EvaluateConstant(C->getFrom(), F))
+      return false;
+    bool FromDouble = C->getFrom()->getCXType() == typ_double;
+    switch (C->getCXType()) {
+    case typ_err:
+      return false;
+    case typ_int:
+      if (!FromDouble) {
+        V.Int = F.Int;
+        return true;
+      }
+      // Out of range, `fptoui` yields poison.
+      if (!(F.FP > -1.0 && F.FP < 4294967296.0))
+        return false;
+      V.Int = F.FP > 0 ? (uint64_t)F.FP : 0;
+      return true;
+    case typ_bool:
+      V.Int = FromDouble ? F.FP < 0 || F.FP > 0 : F.Int != 0;
+      return true;
+    case typ_double:
+      V.FP = FromDouble ? F.FP : (double)F.Int;
+      return true;
+    }
+    return false;
+  }
+
+  default:
+    return false;
+  }
+}
+
+enum CXType IntExprAST::sema() {
+  setCXType(typ_int);
+  return typ_int;
+}
+
+enum CXType DoubleExprAST::sema() {
+  setCXType(typ_double);
+  return typ_double;
+}
+
+enum CXType BooleanExprAST::sema() {
+  setCXType(typ_bool);
+  return typ_bool;
+}
+
+enum CXType VariableExprAST::sema() {
+  if ((Decl = LocalDecls.lookup(Name))) {
+    setCXType(Decl->getType());
+    return getCXType();
+  }
+
+  auto It = GlobalDecls.find(Name);
+  if (It == GlobalDecls.end())
+    return LogErrorT("Unknown variable name");
+  if (ReferencedNames)
+    ReferencedNames->push_back(Name);
+  setCXType(It->second.Type);
+  return getCXType();
+}
+
+enum CXType BinaryExprAST::sema() {
+  if (Op == '=') {
+    VariableExprAST *LHSE = dyn_cast<VariableExprAST>(LHS);
+    if (!LHSE)
+      return LogErrorT("destination of '=' must be a variable");
+
+    if (!LHSE->sema())
+      return typ_err;
+    if (isConstVariable(LHSE))
+      return LogErrorT("Can't assign to const variables");
+
+    if (!RHS->sema())
+      return typ_err;
+    if (RHS->getCXType() != LHSE->getCXType())
+      return LogErrorT("Different types on each side of '='");
+
+    setCXType(LHSE->getCXType());
+    return getCXType();
+  }
+
+  // Check the left spine of a long chain in a loop, as codegen() lowers it.
+  SmallVector<BinaryExprAST *, 8> Spine;
+  Spine.push_back(this);
+  while (auto *B = dyn_cast<BinaryExprAST>(Spine.back()->LHS)) {
+    if (B->Op == '=')
+      break;
+    Spine.push_back(B);
+  }
+
+  enum CXType L = Spine.back()->LHS->sema();
+  for (auto *B : reverse(Spine)) {
+    L = B->semaOperator(L);
+    if (!L)
+      return typ_err;
+  }
+  return L;
+}
+
+enum CXType BinaryExprAST::semaOperator(enum CXType L) {
+  if (!L)
+    return typ_err;
+  enum CXType R = RHS->sema();
+  if (!R)
+    return typ_err;
+
+  if (L != R)
+    return LogErrorT("Binary operation on expressions of different types");
+
+  switch (Op) {
+  default:
+    return LogErrorT("invalid binary operator");
+  case '+':
+  case '-':
+  case '*':
+  case '/':
+    if (L == typ_bool)
+      return LogUndefinedOperator(Op, L);
+    setCXType(L);
+    break;
+  case '%':
+    if (L != typ_int)
+      return LogUndefinedOperator(Op, L);
+    setCXType(L);
+    break;
+  case '<':
+  case '>':
+  case tok_le:
+  case tok_ge:
+    if (L == typ_bool)
+      return LogUndefinedOperator(Op, L);
+    setCXType(typ_bool);
+    break;
+  case tok_eq:
+  case tok_ne:
+    setCXType(typ_bool);
+    break;
+  case tok_lor:
+  case tok_land:
+    if (L != typ_bool)
+      return LogUndefinedOperator(Op, L);
+    setCXType(typ_bool);
+    break;
+  }
+  return getCXType();
+}
+
+enum CXType UnaryExprAST::sema() {
+  enum CXType T = Operand->sema();
+  if (!T)
+    return typ_err;
+
+  switch (Opcode) {
+  default:
+    return LogErrorT("Invalid unary operator");
+
+  case '!':
+    if (T != typ_bool)
+      return LogErrorT("Expected boolean expression after '!'");
+    setCXType(typ_bool);
+    break;
+
+  case tok_ODD:
+    if (T != typ_int)
+      return LogErrorT("Expected int expression after 'ODD'");
+    setCXType(typ_bool);
+    break;
+
+  case tok_increment:
+  case tok_decrement: {
+    auto OpVar = dyn_cast<VariableExprAST>(Operand);
+    if (!OpVar)
+      return LogErrorT(Opcode == tok_increment
+                           ? "Operand of '++' must be a variable"
+                           : "Operand of '--' must be a variable");
+    if (isConstVariable(OpVar))
+      return LogErrorT("Const variables cannot perform self increment");
+    if (T == typ_bool)
+      return LogErrorT(Opcode == tok_increment
+                           ? "operator ++ is not defined for bool"
+                           : "operator -- is not defined for bool");
+    setCXType(T);
+    break;
+  }
+  }
+  return getCXType();
+}
+
+enum CXType CallExprAST::sema() {
+  Proto = FunctionDecls.lookup(Callee);
+  if (!Proto)
+    return LogErrorT("Unknown function referenced");
+  if (ReferencedNames)
+    ReferencedNames->push_back(Callee);
+
+  auto Params = Proto->getArgs();
+  if (Params.size() != Args.size())
+    return LogErrorT("Incorrect # arguments passed");
+
+  for (unsigned i = 0, e = Args.size(); i != e; ++i) {
+    if (!Args[i]->sema())
+      return typ_err;
+    if (Args[i]->getCXType() != Params[i]->getType())
+      return LogErrorT("Incompatible argument type");
+  }
+
+  setCXType(Proto->getRetType());
+  return getCXType();
+}
+
+enum CXType CastExprAST::sema() {
+  if (!From->sema())
+    return typ_err;
+  setCXType(Type);
+  return Type;
+}
+
+int ExprStmtAST::sema() {
+  if (Expr && !Expr->sema())
+    return 1;
+  return 0;
+}
+
+int BlockStmtAST::sema() {
+  LocalDecls.pushScope();
+
+  for (auto *Elem : Elems) {
+    if (auto VarDecl = dyn_cast<VarDeclAST>(Elem)) {
+      if (VarDecl->sema())
+        return 1;
+    } else if (cast<StmtAST>(Elem)->sema()) {
+      return 1;
+    }
+  }
+
+  LocalDecls.popScope();
+  return 0;
+}
+
+int VarDeclAST::sema() {
+  if (LocalDecls.isBoundInScope(Name))
+    return LogErrorC("The name has been taken in the same scope");
+
+  if (Val) {
+    if (!Val->sema())
+      return 1;
+    if (Val->getCXType() != Type)
+      return LogErrorC("Incompatible types.");
+  }
+
+  LocalDecls.insert(Name, this);
+  return 0;
+}
+
+int GlobVarDeclAST::sema() {
+  if (GlobalDecls.count(Name) || FunctionDecls.count(Name))
+    return LogErrorC("Redefinition of identifier");
+
+  if (Val) {
+    switch (Type) {
+    case typ_err:
+      return LogErrorC("Unreachable!");
+    case typ_int:
+      if (!isa<IntExprAST>(Val))
+        return LogErrorC("Expected initial value to be int constant");
+      break;
+    case typ_bool:
+      if (!isa<BooleanExprAST>(Val))
+        return LogErrorC("Expected initial value to be bool constant");
+      break;
+    case typ_double:
+      if (!isa<DoubleExprAST>(Val))
+        return LogErrorC("Expected initial value to be double constant");
+      break;
+    }
+    Val->sema();
+  }
+
+  GlobalDecls[Name] = {Type, isConst};
+  return 0;
+}
+
+int PrototypeAST::sema() {
+  if (GlobalDecls.count(Name) || FunctionDecls.count(Name))
+    return LogErrorC("Redeclaration of identifier");
+
+  for (auto *Arg : Args)
+    if (Arg->getType() == typ_err)
+      return LogErrorC("invalid parameter type");
+  if (RetTyp == typ_err)
+    return LogErrorC("invalid return type");
+
+  FunctionDecls[Name] = this;
+  return 0;
+}
+
+int FunctionAST::sema() {
+  auto Name = Proto->getName();
+  if (GlobalDecls.count(Name))
+    return LogErrorC("Redefinition of identifier");
+
+  bool Declared = FunctionDecls.count(Name);
+  if (!Declared) {
+    if (Proto->sema())
+      return 1;
+  } else if (!(*Proto == *FunctionDecls.lookup(Name))) {
+    return LogErrorC("Function has conflicting signatures");
+  }
+
+  if (DefinedFunctions.count(Name))
+    return LogErrorC("Function cannot be redefined.");
+
+  // A body reused from an earlier build passed these checks back then.
+  if (!Body) {
+    DefinedFunctions.insert(Name);
+    return 0;
+  }
+
+  CurRetType = Proto->getRetType();
+  LoopDepth = BreakableDepth = 0;
+  LocalDecls.clear();
+  LocalDecls.pushScope();
+  for (auto *Param : Proto->getArgs())
+    LocalDecls.insert(Param->getName(), Param);
+
+  if (Body->sema()) {
+    // Forget a function that only this broken definition declared.
+    if (!Declared)
+      FunctionDecls.erase(Name);
+    return 1;
+  }
+
+  DefinedFunctions.insert(Name);
+  return 0;
+}
+
+int IfStmtAST::sema() {
+  if (!Cond->sema())
+    return 1;
+  if (Cond->getCXType() != typ_bool)
+    return LogErrorC("Expected boolean expression in if");
+
+  if (Then->sema())
+    return 1;
+  if (Else && Else->sema())
+    return 1;
+  return 0;
+}
+
+int ForStmtAST::sema() {
+  LocalDecls.pushScope();
+
+  if (Var && Var->sema())
+    return 1;
+
+  if (End) {
+    if (!End->sema())
+      return 1;
+    if (End->getCXType() != typ_bool)
+      return LogErrorC("Expected boolean expression in for");
+  }
+
+  if (Step && !Step->sema())
+    return 1;
+
+  ++LoopDepth;
+  ++BreakableDepth;
+  int ret = Body->sema();
+  --LoopDepth;
+  --BreakableDepth;
+  if (ret)
+    return 1;
+
+  LocalDecls.popScope();
+  return 0;
+}
+
+int SwitchStmtAST::sema() {
+  auto ExprType = Expr->sema();
+  if (!ExprType)
+    return 1;
+  if (ExprType == typ_double)
+    return LogErrorC("Expected integer types in switch");
+
+  SmallDenseSet<uint64_t, 16> Seen;
+  for (auto &Item : BasicBlocks) {
+    for (auto *Cond : Item.Labels) {
+      if (!Cond) // the "default" case
+        continue;
+      if (!Cond->sema())
+        return 1;
+      if (Cond->getCXType() != ExprType)
+        return LogErrorC("Expected same type in switch-case");
+
+      ConstValue C;
+      if (!EvaluateConstant(Cond, C))
+        return LogErrorC("Expected constant expression in case label");
+      if (!Seen.insert(C.Int).second)
+        return LogErrorC("Duplicate case value in switch");
+    }
+  }
+
+  ++BreakableDepth;
+  int ret = 0;
+  for (auto &Item : BasicBlocks)
+    for (auto *Stmt : Item.Stmts)
+      if (!ret && Stmt->sema())
+        ret = 1;
+  --BreakableDepth;
+  return ret;
+}
+
+/**
+ * Check the body and the condition of a `while`, `do-while` or
+ * `repeat-until` loop.
+ */
+static int semaLoop(StmtAST *Body, ExprAST *Cond, const char *CondError) {
+  if (!Cond->sema())
+    return 1;
+  if (Cond->getCXType() != typ_bool)
+    return LogErrorC(CondError);
+
+  ++LoopDepth;
+  ++BreakableDepth;
+  int ret = Body->sema();
+  --LoopDepth;
+  --BreakableDepth;
+  return ret;
+}
+
+int WhileStmtAST::sema() {
+  return semaLoop(Body, Cond, "Expected boolean expression in while");
+}
+
+int DoStmtAST::sema() {
+  return semaLoop(Body, Cond, "Expected boolean expression in do-while");
+}
+
+int UntilStmtAST::sema() {
+  return semaLoop(Body, Cond, "Expected boolean expression in repeat-until");
+}
+
+int ReadStmtAST::sema() {
+  auto Var = dyn_cast<VariableExprAST>(this->Var);
+  if (!Var)
+    return LogErrorC("Can only read to a variable");
+
+  if (!Var->sema())
+    return 1;
+  if (isConstVariable(Var))
+    return LogErrorC("Cannot read to a const variable");
+  return 0;
+}
+
+int WriteStmtAST::sema() { return Val->sema() ? 0 : 1; }
+
+int ContStmtAST::sema() {
+  if (!LoopDepth)
+    return LogErrorC("Cannot use 'continue' here");
+  return 0;
+}
+
+int BrkStmtAST::sema() {
+  if (!BreakableDepth)
+    return LogErrorC("Cannot use 'break' here");
+  return 0;
+}
+
+int RetStmtAST::sema() {
+  if (!Val->sema())
+    return 1;
+  if (Val->getCXType() != CurRetType)
+    return LogErrorC("Incompatable return type");
+  return 0;
+}
+
+int ExitStmtAST::sema() {
+  if (!ExitCode->sema())
+    return 1;
+  if (ExitCode->getCXType() != typ_int)
+    return LogErrorC("Expected int expression in exit");
+  return 0;
+}
@@ -0,0 +1,256 @@
+#include "server.h"
+#include "driver.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <vector>
+
+/// Written to by the SIGCHLD handler, so that the accept loop wakes up to
+/// reap children.
+static int ChildPipe[2];
+
+static void OnChildExit(int) {
+  int SavedErrno = errno;
+  char C = 0;
+  (void)!write(ChildPipe[1], &C, 1);
+  errno = SavedErrno;
+}
+
+/// Read exactly Size bytes.
+static bool ReadAll(int FD, char *Buf, size_t Size) {
+  while (Size) {
+    ssize_t N = read(FD, Buf, Size);
+    if (N < 0 && errno == EINTR)
+      continue;
+    if (N <= 0)
+      return false;
+    Buf += N;
+    Size -= N;
+  }
+  return true;
+}
+
+/// Receive a request, and the standard streams of the client along with it.
+/// @param Strings Set to the working directory and the arguments.
+static int ReceiveRequest(int Conn, int (&FDs)[3],
+                          std::vector<std::string> &Strings) {
+  uint32_t Size;
+  char Control[CMSG_SPACE(sizeof(FDs))];
+  iovec IOV = {&Size, sizeof(Size)};
+  msghdr Msg = {};
+  Msg.msg_iov = &IOV;
+  Msg.msg_iovlen = 1;
+  Msg.msg_control = Control;
+  Msg.msg_controllen = sizeof(Control);
+
+  ssize_t N;
+  do
+    N = recvmsg(Conn, &Msg, MSG_WAITALL);
+  while (N < 0 && errno == EINTR);
+  cmsghdr *C = CMSG_FIRSTHDR(&Msg);
+  if (N != sizeof(Size) || !C || C->cmsg_type != SCM_RIGHTS ||
+      C->cmsg_len != CMSG_LEN(sizeof(FDs)))
+    return 1;
+  memcpy(FDs, CMSG_DATA(C), sizeof(FDs));
+
+  std::vector<char> Buf(Size);
+  if (!ReadAll(Conn, Buf.data(), Size) || (Size && Buf.back() != '\0'))
+    return 1;
+  for (size_t i = 0; i < Size; i += Strings.back().size() + 1)
+    Strings.emplace_back(&Buf[i]);
+  return Strings.empty();
+}
+
+/// Compile for a client in a process of its own.
+static int ServeClient(int Conn) {
+  int FDs[3];
+  std::vector<std::string> Strings;
+  if (ReceiveRequest(Conn, FDs, Strings)) {
+    fprintf(stderr, "Warning: ignoring a malformed request\n");
+    return 1;
+  }
+
+  for (int i = 0; i < 3; ++i) {
+    dup2(FDs[i], i);
+    close(FDs[i]);
+  }
+  if (chdir(Strings[0].c_str())) {
+    fprintf(stderr, "Error: cannot enter '%s': %s\n", Strings[0].c_str(),
+            strerror(errno));
+    return 1;
+  }
+
+  // The rest is the command line, with the client as the program.
+  SmallVector<char *, 16> Argv;
+  Argv.push_back(const_cast<char *>("cxc"));
+  for (size_t i = 1; i < Strings.size(); ++i)
+    Argv.push_back(&Strings[i][0]);
+  Argv.push_back(nullptr);
+
+  DriverOptions Opts;
+  int ret = ParseDriverArgs(Argv.size() - 1, Argv.data(), Opts);
+  if (ret == 0 && (Opts.Server || Opts.Watch)) {
+    fprintf(stderr, "Error: the server does not take --server or --watch\n");
+    ret = 1;
+  } else if (ret == 0 && !Opts.Help) {
+    ret = RunDriver(Opts);
+  }
+  return ret;
+}
+
+/// Create the directory of the default socket, or check the one there is.
+/// Anyone can create it in /tmp first, so it must be ours and closed to
+/// everyone else.
+static int MakePrivateDir(const std::string &Dir) {
+  if (mkdir(Dir.c_str(), 0700) && errno != EEXIST) {
+    fprintf(stderr, "Error: cannot create '%s': %s\n", Dir.c_str(),
+            strerror(errno));
+    return 1;
+  }
+  struct stat St;
+  if (lstat(Dir.c_str(), &St) || !S_ISDIR(St.st_mode) ||
+      St.st_uid != getuid() || (St.st_mode & 0777) != 0700) {
+    fprintf(stderr,
+            "Error: '%s' is not a directory of yours with mode 0700\n",
+            Dir.c_str());
+    return 1;
+  }
+  return 0;
+}
+
+int RunServer(const std::string &Path) {
+  std::string Dir = GetPrivateSocketDir();
+  if (Path.compare(0, Dir.size() + 1, Dir + "/") == 0 && MakePrivateDir(Dir))
+    return 1;
+
+  sockaddr_un Addr = {};
+  Addr.sun_family = AF_UNIX;
+  if (Path.size() >= sizeof(Addr.sun_path)) {
+    fprintf(stderr, "Error: socket path '%s' is too long\n", Path.c_str());
+    return 1;
+  }
+  strcpy(Addr.sun_path, Path.c_str());
+
+  int Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (Listener < 0) {
+    fprintf(stderr, "Error: cannot create a socket: %s\n", strerror(errno));
+    return 1;
+  }
+  // A socket nobody listens on is left over from a server that is gone.
+  if (connect(Listener, (sockaddr *)&Addr, sizeof(Addr)) == 0) {
+    fprintf(stderr, "Error: a server is already listening on '%s'\n",
+            Path.c_str());
+    return 1;
+  }
+  close(Listener);
+  unlink(Path.c_str());
+
+  // Only we may connect to the socket, from the moment it exists.
+  mode_t OldMask = umask(0177);
+  Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  bool Bound =
+      Listener >= 0 && bind(Listener, (sockaddr *)&Addr, sizeof(Addr)) == 0;
+  umask(OldMask);
+  if (!Bound || listen(Listener, SOMAXCONN)) {
+    fprintf(stderr, "Error: cannot listen on '%s': %s\n", Path.c_str(),
+            strerror(errno));
+    return 1;
+  }
+
+  if (pipe(ChildPipe)) {
+    fprintf(stderr, "Error: cannot create a pipe: %s\n", strerror(errno));
+    return 1;
+  }
+  fcntl(ChildPipe[1], F_SETFL, O_NONBLOCK);
+  struct sigaction Action = {};
+  Action.sa_handler = OnChildExit;
+  Action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  sigaction(SIGCHLD, &Action, nullptr);
+  // A client that goes away must not take the server with it.
+  signal(SIGPIPE, SIG_IGN);
+
+  // Done once here instead of in every compilation.
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  InitializeNativeTargetAsmParser();
+
+  fprintf(stderr, "Listening on '%s'\n", Path.c_str());
+
+  // The connection of every client whose process is still running.
+  DenseMap<pid_t, int> Clients;
+  while (true) {
+    pollfd FDs[2] = {{Listener, POLLIN, 0}, {ChildPipe[0], POLLIN, 0}};
+    if (poll(FDs, 2, -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      fprintf(stderr, "Error: %s\n", strerror(errno));
+      return 1;
+    }
+
+    if (FDs[1].revents & POLLIN) {
+      char Buf[64];
+      (void)!read(ChildPipe[0], Buf, sizeof(Buf));
+      // The status is sent from here rather than by the child, which may
+      // stop in the middle of the program it runs, or crash.
+      int Status;
+      pid_t Pid;
+      while ((Pid = waitpid(-1, &Status, WNOHANG)) > 0) {
+        auto It = Clients.find(Pid);
+        if (It == Clients.end())
+          continue;
+        int32_t ret = WIFEXITED(Status) ? WEXITSTATUS(Status)
+                                        : 128 + WTERMSIG(Status);
+        (void)!write(It->second, &ret, sizeof(ret));
+        close(It->second);
+        Clients.erase(It);
+      }
+    }
+
+    if (!(FDs[0].revents & POLLIN))
+      continue;
+    int Conn = accept(Listener, nullptr, nullptr);
+    if (Conn < 0)
+      continue;
+    if (!IsPeerSameUser(Conn)) {
+      fprintf(stderr, "Warning: turning away a client of another user\n");
+      close(Conn);
+      continue;
+    }
+
+    pid_t Pid = fork();
+    if (Pid == 0) {
+      close(Listener);
+      close(ChildPipe[0]);
+      close(ChildPipe[1]);
+      for (auto &Entry : Clients)
+        close(Entry.second);
+      signal(SIGCHLD, SIG_DFL);
+      signal(SIGPIPE, SIG_DFL);
+
+      int ret = ServeClient(Conn);
+      outs().flush();
+      errs().flush();
+      fflush(nullptr);
+      _exit(ret);
+    }
+    if (Pid < 0) {
+      fprintf(stderr, "Warning: cannot fork: %s\n", strerror(errno));
+      int32_t ret = 1;
+      (void)!write(Conn, &ret, sizeof(ret));
+      close(Conn);
+      continue;
+    }
+    Clients[Pid] = Conn;
+  }
+}
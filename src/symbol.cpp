@@ -0,0 +1,59 @@
+#include "symbol.h"
+#include <llvm/ADT/StringMap.h>
+#include <mutex>
+
+/// Spellings own their characters; the name of an ID points into them.
+static StringMap<SymbolID> &getSymbols() {
+  static StringMap<SymbolID> Symbols;
+  return Symbols;
+}
+
+/// Guards the table above and the names below, which are shared by all the
+/// threads that parse.
+static std::mutex SymbolsLock;
+
+/// Names this thread has interned or looked up before, so that most lookups
+/// need not take the lock.
+static thread_local StringMap<SymbolID> SeenSymbols;
+
+// Names are stored in fixed-size chunks that never move, so that a thread
+// may look up the names it was handed while other threads intern new ones.
+static constexpr unsigned ChunkBits = 12;
+static constexpr SymbolID ChunkSize = SymbolID(1) << ChunkBits;
+
+static StringRef *Chunks[1u << (32 - ChunkBits)];
+/// ID 0 is the empty name.
+static size_t NumNames = 1;
+
+SymbolID internSymbol(StringRef Name) {
+  if (Name.empty())
+    return 0;
+
+  auto Seen = SeenSymbols.find(Name);
+  if (Seen != SeenSymbols.end())
+    return Seen->getValue();
+
+  std::lock_guard<std::mutex> Guard(SymbolsLock);
+  auto Inserted = getSymbols().try_emplace(Name, NumNames);
+  SymbolID ID = Inserted.first->getValue();
+  if (Inserted.second) {
+    ++NumNames;
+    auto &Chunk = Chunks[ID >> ChunkBits];
+    if (!Chunk)
+      Chunk = new StringRef[ChunkSize];
+    Chunk[ID & (ChunkSize - 1)] = Inserted.first->getKey();
+  }
+  SeenSymbols.try_emplace(Name, ID);
+  return ID;
+}
+
+StringRef getSymbolName(SymbolID ID) {
+  if (ID == 0)
+    return "";
+  return Chunks[ID >> ChunkBits][ID & (ChunkSize - 1)];
+}
+
+size_t getNumSymbols() {
+  std::lock_guard<std::mutex> Guard(SymbolsLock);
+  return NumNames;
+}
@@ -0,0 +1,247 @@
+#include "timing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+bool TimeReportEnabled = false;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+/**
+ * @brief Seconds spent in each phase.
+ */
+struct PhaseTimes {
+  double Seconds[NumTimePhases] = {};
+
+  double total() const {
+    double Sum = 0;
+    for (double S : Seconds)
+      Sum += S;
+    return Sum;
+  }
+};
+
+/**
+ * @brief What a thread has not charged to a declaration yet.
+ */
+struct ThreadTimes {
+  PhaseTimes Times;
+  /**
+   * @brief Phases of the open scopes, innermost last.
+   */
+  SmallVector<enum TimePhase, 8> Stack;
+  /**
+   * @brief When the innermost scope was last entered or resumed.
+   */
+  Clock::time_point Last;
+};
+
+/**
+ * @brief Runs of a pass or an analysis.
+ */
+struct PassTimes {
+  double Seconds = 0;
+  unsigned Runs = 0;
+  bool isAnalysis = false;
+};
+
+using FunctionTimes = std::pair<std::string, PhaseTimes>;
+} // namespace
+
+static const char *PhaseNames[NumTimePhases] = {
+    "lex", "parse", "sema", "irgen", "verify", "opt", "emit"};
+
+static thread_local ThreadTimes Current;
+
+static std::mutex TimesLock;
+static PhaseTimes Totals;
+/// Functions in the order they are first recorded in.
+static std::vector<FunctionTimes> Functions;
+static StringMap<unsigned> FunctionIndex;
+static StringMap<PassTimes> Passes;
+
+/// Charge the time since the last switch of phases to the innermost one.
+static void ChargeInnermost(ThreadTimes &T, Clock::time_point Now) {
+  T.Times.Seconds[T.Stack.back()] +=
+      std::chrono::duration<double>(Now - T.Last).count();
+}
+
+TimeScope::TimeScope(enum TimePhase Phase) : Active(TimeReportEnabled) {
+  if (!Active)
+    return;
+  auto &T = Current;
+  auto Now = Clock::now();
+  if (!T.Stack.empty())
+    ChargeInnermost(T, Now);
+  T.Stack.push_back(Phase);
+  T.Last = Now;
+}
+
+TimeScope::~TimeScope() {
+  if (!Active)
+    return;
+  auto &T = Current;
+  auto Now = Clock::now();
+  ChargeInnermost(T, Now);
+  T.Stack.pop_back();
+  T.Last = Now;
+}
+
+/// Get the times of a function, adding it if it is new. The lock must be
+/// held.
+static PhaseTimes &getFunctionTimes(StringRef Function) {
+  auto Inserted = FunctionIndex.try_emplace(Function, Functions.size());
+  if (Inserted.second)
+    Functions.emplace_back(Function.str(), PhaseTimes());
+  return Functions[Inserted.first->second].second;
+}
+
+void RecordDeclarationTimes(StringRef Function) {
+  if (!TimeReportEnabled)
+    return;
+  auto &T = Current;
+  std::lock_guard<std::mutex> Lock(TimesLock);
+  PhaseTimes *FT = Function.empty() ? nullptr : &getFunctionTimes(Function);
+  for (unsigned i = 0; i != NumTimePhases; ++i) {
+    Totals.Seconds[i] += T.Times.Seconds[i];
+    if (FT)
+      FT->Seconds[i] += T.Times.Seconds[i];
+  }
+  T.Times = PhaseTimes();
+}
+
+void RecordPassTime(StringRef Pass, bool isAnalysis, StringRef Function,
+                    double Seconds) {
+  std::lock_guard<std::mutex> Lock(TimesLock);
+  auto &PT = Passes[Pass];
+  PT.Seconds += Seconds;
+  ++PT.Runs;
+  PT.isAnalysis = isAnalysis;
+  // The phase total comes from the scope around the whole pipeline.
+  if (!Function.empty())
+    getFunctionTimes(Function).Seconds[time_opt] += Seconds;
+}
+
+/// Functions shown in the table, the slowest first.
+static constexpr unsigned MaxTableFunctions = 20;
+
+static void PrintTable(double WallSeconds,
+                       ArrayRef<StringMapEntry<PassTimes> *> SortedPasses,
+                       ArrayRef<FunctionTimes *> Slowest) {
+  double Total = Totals.total();
+  fprintf(stderr,
+          "===-------------------------------------------------------------"
+          "------------===\n"
+          "                           Compile time report\n"
+          "===-------------------------------------------------------------"
+          "------------===\n"
+          "  Total wall time: %.3f ms\n\n"
+          "  %-16s %12s %7s\n",
+          WallSeconds * 1e3, "Phase", "Time (ms)", "%");
+  for (unsigned i = 0; i != NumTimePhases; ++i)
+    fprintf(stderr, "  %-16s %12.3f %6.1f%%\n", PhaseNames[i],
+            Totals.Seconds[i] * 1e3,
+            Total > 0 ? Totals.Seconds[i] / Total * 100 : 0.0);
+  fprintf(stderr, "  %-16s %12.3f\n", "total", Total * 1e3);
+
+  if (!SortedPasses.empty()) {
+    fprintf(stderr, "\n  %-40s %12s %7s\n", "Pass or analysis", "Time (ms)",
+            "Runs");
+    for (auto *Entry : SortedPasses) {
+      std::string Name = Entry->getKey().str();
+      if (Entry->getValue().isAnalysis)
+        Name += " (analysis)";
+      fprintf(stderr, "  %-40s %12.3f %7u\n", Name.c_str(),
+              Entry->getValue().Seconds * 1e3, Entry->getValue().Runs);
+    }
+  }
+
+  if (!Slowest.empty()) {
+    fprintf(stderr, "\n  %-24s", "Function (ms)");
+    for (auto *Name : PhaseNames)
+      fprintf(stderr, " %8s", Name);
+    fprintf(stderr, " %9s\n", "total");
+    for (auto *F : Slowest) {
+      fprintf(stderr, "  %-24s", F->first.c_str());
+      for (double S : F->second.Seconds)
+        fprintf(stderr, " %8.3f", S * 1e3);
+      fprintf(stderr, " %9.3f\n", F->second.total() * 1e3);
+    }
+    if (Functions.size() > Slowest.size())
+      fprintf(stderr, "  (%zu more functions)\n",
+              Functions.size() - Slowest.size());
+  }
+}
+
+static void PrintJSON(double WallSeconds,
+                      ArrayRef<StringMapEntry<PassTimes> *> SortedPasses) {
+  json::OStream J(errs(), 2);
+  J.object([&] {
+    J.attribute("wall_ms", WallSeconds * 1e3);
+    J.attributeObject("phases_ms", [&] {
+      for (unsigned i = 0; i != NumTimePhases; ++i)
+        J.attribute(PhaseNames[i], Totals.Seconds[i] * 1e3);
+      J.attribute("total", Totals.total() * 1e3);
+    });
+    J.attributeArray("passes", [&] {
+      for (auto *Entry : SortedPasses)
+        J.object([&] {
+          J.attribute("name", Entry->getKey());
+          J.attribute("kind",
+                      Entry->getValue().isAnalysis ? "analysis" : "pass");
+          J.attribute("ms", Entry->getValue().Seconds * 1e3);
+          J.attribute("runs", Entry->getValue().Runs);
+        });
+    });
+    J.attributeArray("functions", [&] {
+      for (auto &F : Functions)
+        J.object([&] {
+          J.attribute("name", F.first);
+          for (unsigned i = 0; i != NumTimePhases; ++i)
+            J.attribute(PhaseNames[i], F.second.Seconds[i] * 1e3);
+          J.attribute("total", F.second.total() * 1e3);
+        });
+    });
+  });
+  errs() << "\n";
+  errs().flush();
+}
+
+void PrintTimeReport(bool JSON, double WallSeconds) {
+  RecordDeclarationTimes("");
+  std::lock_guard<std::mutex> Lock(TimesLock);
+
+  std::vector<StringMapEntry<PassTimes> *> SortedPasses;
+  for (auto &Entry : Passes)
+    SortedPasses.push_back(&Entry);
+  llvm::sort(SortedPasses, [](StringMapEntry<PassTimes> *A,
+                              StringMapEntry<PassTimes> *B) {
+    if (A->getValue().Seconds != B->getValue().Seconds)
+      return A->getValue().Seconds > B->getValue().Seconds;
+    return A->getKey() < B->getKey();
+  });
+
+  if (JSON) {
+    PrintJSON(WallSeconds, SortedPasses);
+    return;
+  }
+
+  std::vector<FunctionTimes *> Slowest;
+  for (auto &F : Functions)
+    Slowest.push_back(&F);
+  std::stable_sort(Slowest.begin(), Slowest.end(),
+                   [](FunctionTimes *A, FunctionTimes *B) {
+                     return A->second.total() > B->second.total();
+                   });
+  if (Slowest.size() > MaxTableFunctions)
+    Slowest.resize(MaxTableFunctions);
+  PrintTable(WallSeconds, SortedPasses, Slowest);
+}
@@ -7,6 +7,27 @@ if [[ $* = *--continue* ]]; then
 	set +e
 fi
 
+# Run the tests as native executables or in the JIT instead of through lli.
+if [[ $* = *--native* ]]; then
+	native=1
+	output="-o /tmp/cxexe"
+elif [[ $* = *--jit* ]]; then
+	jit=1
+fi
+
+run() {
+	if [[ $native -eq 1 ]]; then
+		/tmp/cxexe
+	elif [[ $jit -eq 1 ]]; then
+		./bin/main $CXCFLAGS --run $code "${units[@]}"
+	else
+		lli -load ./bin/libcxrt.so /tmp/cxcode
+	fi
+}
+
+# A test may span several files: test/pass_N.c and any test/pass_N.*.c.
+shopt -s nullglob
+
 i=1
 code="test/$1_$i.c"
 while [[ -e $code ]]; do
@@ -19,19 +40,20 @@ while [[ -e $code ]]; do
 |					      |
 ================================================
 \033[93;3m" $i
+	units=(test/$1_$i.*.c)
 	if [[ $verbose -eq 1 ]]; then
 		printf "\033[91m"
-		./bin/main $code > /tmp/cxcode
+		./bin/main $CXCFLAGS $output $code "${units[@]}" > /tmp/cxcode
 		printf "\033[93m"
 	else
-		./bin/main $code > /tmp/cxcode 2>/dev/null
+		./bin/main $CXCFLAGS $output $code "${units[@]}" > /tmp/cxcode 2>/dev/null
 	fi
 	input="test/$1_$i.in"
 	set +e;
 	if [[ -e $input ]] ; then
-		lli /tmp/cxcode < $input > /tmp/cxout
+		run < $input > /tmp/cxout
 	else
-		lli /tmp/cxcode > /tmp/cxout
+		run > /tmp/cxout
 	fi
 	exitcode=$?
 	if [[ $verbose -ne 1 ]]; then
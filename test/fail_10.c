@@ -0,0 +1,8 @@
+int main() {
+  int x = 1;
+  int y = 1;
+  switch (x) {
+  case y:
+    write 1;
+  }
+}
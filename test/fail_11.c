@@ -0,0 +1,7 @@
+int f(double x) {
+  return 1;
+}
+
+int main() {
+  write f(1);
+}
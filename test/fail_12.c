@@ -0,0 +1,6 @@
+int main() {
+  int i = 3;
+  while (i) {
+    --i;
+  }
+}
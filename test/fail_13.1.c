@@ -0,0 +1 @@
+int square(int x) { return x * x; }
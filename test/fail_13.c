@@ -0,0 +1,6 @@
+double square(double x);
+
+int main() {
+  write square(2.0);
+  return 0;
+}
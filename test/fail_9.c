@@ -0,0 +1,9 @@
+int main() {
+  int x = 1;
+  switch (x) {
+  case 1:
+    write 1;
+  case 3 - 2:
+    write 2;
+  }
+}
@@ -0,0 +1,10 @@
+int main() {
+  write 4294967295;
+  write 007;
+  write 0.1;
+  write 123456.789;
+  write 3.14159265358979323846;
+  write .5;
+  write 10.;
+  write 0.000000000000000000000000125;
+}
@@ -0,0 +1,27 @@
+int x = 1;
+
+int f(int x) {
+  write x;
+  {
+    int x = 3;
+    write x;
+    {
+      double x = 4.5;
+      write x;
+    }
+    write x;
+  }
+  return x;
+}
+
+int main() {
+  write x;
+  int i = 7;
+  for (int i = 0; i < 2; ++i) {
+    int x = i + 10;
+    write x;
+  }
+  write i;
+  write f(2);
+  write x;
+}
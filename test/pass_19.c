@@ -0,0 +1,13 @@
+int main() {
+  int x = 1;
+  int y;
+  int z;
+  y = z = 5;
+  write y + z;
+  write 10 - 4 - 3;
+  write 2 + 3 * 4 - 6 / 2;
+  write 17 % 5 * 3;
+  write 1 < 2 && 3 > 4 || 5 == 5;
+  write x + x + x + x + x + x + x + x + x + x + x + x + x + x + x + x;
+  write x * 2 - x * 2 - x * 2 + x * 2 + x * 2 + x * 2;
+}
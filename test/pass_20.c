@@ -0,0 +1,229 @@
+int f(int x) {
+  switch (x) {
+  case 0:
+    return 0;
+  case 3:
+    return 6;
+  case 6:
+    return 12;
+  case 9:
+    return 18;
+  case 12:
+    return 24;
+  case 15:
+    return 30;
+  case 18:
+    return 36;
+  case 21:
+    return 42;
+  case 24:
+    return 48;
+  case 27:
+    return 54;
+  case 30:
+    return 60;
+  case 33:
+    return 66;
+  case 36:
+    return 72;
+  case 39:
+    return 78;
+  case 42:
+    return 84;
+  case 45:
+    return 90;
+  case 48:
+    return 96;
+  case 51:
+    return 102;
+  case 54:
+    return 108;
+  case 57:
+    return 114;
+  case 60:
+    return 120;
+  case 63:
+    return 126;
+  case 66:
+    return 132;
+  case 69:
+    return 138;
+  case 72:
+    return 144;
+  case 75:
+    return 150;
+  case 78:
+    return 156;
+  case 81:
+    return 162;
+  case 84:
+    return 168;
+  case 87:
+    return 174;
+  case 90:
+    return 180;
+  case 93:
+    return 186;
+  case 96:
+    return 192;
+  case 99:
+    return 198;
+  case 102:
+    return 204;
+  case 105:
+    return 210;
+  case 108:
+    return 216;
+  case 111:
+    return 222;
+  case 114:
+    return 228;
+  case 117:
+    return 234;
+  case 120:
+    return 240;
+  case 123:
+    return 246;
+  case 126:
+    return 252;
+  case 129:
+    return 258;
+  case 132:
+    return 264;
+  case 135:
+    return 270;
+  case 138:
+    return 276;
+  case 141:
+    return 282;
+  case 144:
+    return 288;
+  case 147:
+    return 294;
+  case 150:
+    return 300;
+  case 153:
+    return 306;
+  case 156:
+    return 312;
+  case 159:
+    return 318;
+  case 162:
+    return 324;
+  case 165:
+    return 330;
+  case 168:
+    return 336;
+  case 171:
+    return 342;
+  case 174:
+    return 348;
+  case 177:
+    return 354;
+  case 180:
+    return 360;
+  case 183:
+    return 366;
+  case 186:
+    return 372;
+  case 189:
+    return 378;
+  case 192:
+    return 384;
+  case 195:
+    return 390;
+  case 198:
+    return 396;
+  case 201:
+    return 402;
+  case 204:
+    return 408;
+  case 207:
+    return 414;
+  case 210:
+    return 420;
+  case 213:
+    return 426;
+  case 216:
+    return 432;
+  case 219:
+    return 438;
+  case 222:
+    return 444;
+  case 225:
+    return 450;
+  case 228:
+    return 456;
+  case 231:
+    return 462;
+  case 234:
+    return 468;
+  case 237:
+    return 474;
+  case 240:
+    return 480;
+  case 243:
+    return 486;
+  case 246:
+    return 492;
+  case 249:
+    return 498;
+  case 252:
+    return 504;
+  case 255:
+    return 510;
+  case 258:
+    return 516;
+  case 261:
+    return 522;
+  case 264:
+    return 528;
+  case 267:
+    return 534;
+  case 270:
+    return 540;
+  case 273:
+    return 546;
+  case 276:
+    return 552;
+  case 279:
+    return 558;
+  case 282:
+    return 564;
+  case 285:
+    return 570;
+  case 288:
+    return 576;
+  case 291:
+    return 582;
+  case 294:
+    return 588;
+  case 297:
+    return 594;
+  case 1000 + 1:
+    return 1;
+  case 0 - 1 + 3 * 2:
+  case 7:
+    return 57;
+  default:
+    return 0 - 1;
+  }
+}
+
+int main() {
+  write f(0);
+  write f(297);
+  write f(5);
+  write f(7);
+  write f(1001);
+  write f(4);
+  bool b = true;
+  switch (b) {
+  case false:
+    write 0;
+  case true:
+    write 1;
+  }
+  switch (3) {
+  }
+}
@@ -0,0 +1,22 @@
+int main() {
+  double d;
+  write 0;
+  write 0 - 1;
+  write 2147483647 + 1;
+  write 1 < 2;
+  write 2 < 1;
+  write 0.0;
+  write 0.0 - 0.0000005;
+  write 0.0000015;
+  write 0.0000025;
+  write 1.0 / 3.0;
+  write 0.0 - 2.0 / 3.0;
+  write 123456789.987654321;
+  write 1000000000000000.0 + 0.5;
+  d = 1.0;
+  for (int i = 0; i < 12; ++i) {
+    write d;
+    d = d * 100000.0;
+  }
+  return 0;
+}
@@ -0,0 +1,20 @@
+int main() {
+  int n;
+  double d;
+  bool b;
+  read n;
+  for (int i = 0; i < n; ++i) {
+    read d;
+    write d;
+  }
+  for (int i = 0; i < 4; ++i) {
+    read b;
+    write b;
+  }
+  read n;
+  write n;
+  read n;
+  write n;
+  read d;
+  write d;
+}
@@ -0,0 +1,14 @@
+bool even(int n);
+
+int calls = 0;
+
+int square(int x) { return x * x; }
+
+double half(double x) { return x / 2.0; }
+
+bool odd(int n) {
+  calls = calls + 1;
+  if (n == 0)
+    return false;
+  return even(n - 1);
+}
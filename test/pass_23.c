@@ -0,0 +1,23 @@
+int square(int x);
+double half(double x);
+bool odd(int n);
+
+int count = 3;
+
+bool even(int n) {
+  if (n == 0)
+    return true;
+  return odd(n - 1);
+}
+
+int main() {
+  write square(count);
+  write half(5.0);
+  if (even(10)) {
+    write 1;
+  }
+  if (odd(7)) {
+    write 2;
+  }
+  return 0;
+}